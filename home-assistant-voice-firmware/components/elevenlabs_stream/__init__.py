@@ -20,9 +20,51 @@ CONF_ON_END = "on_end"
 CONF_MICROPHONE = "microphone"
 CONF_ELEVENLABS_SPEAKER = "elevenlabs_speaker"
 CONF_ACTIVATION_SPEAKER = "activation_speaker"
+CONF_RECEIVE_SLOTS = "receive_slots"
+CONF_RECEIVE_SLOT_SIZE = "receive_slot_size"
+CONF_UPLINK_FRAME_DURATION = "uplink_frame_duration"
+CONF_UPLINK_VAD = "uplink_vad"
+CONF_UPLINK_CODEC = "uplink_codec"
+CONF_MICROPHONE_CHANNEL = "microphone_channel"
+CONF_BARGE_IN = "barge_in"
+CONF_UPLINK_SEND_TIMEOUT = "uplink_send_timeout"
+CONF_CONTROL_SEND_TIMEOUT = "control_send_timeout"
+CONF_UPLINK_MAX_BACKLOG = "uplink_max_backlog"
+CONF_CONNECT_BUFFER = "connect_buffer"
+CONF_PLAYBACK_BUFFER_SIZE = "playback_buffer_size"
+CONF_JITTER_BUFFER = "jitter_buffer"
+CONF_MIN_DELAY = "min_delay"
+CONF_MAX_DELAY = "max_delay"
+CONF_THRESHOLD = "threshold"
+CONF_HANGOVER = "hangover"
+CONF_PRE_ROLL = "pre_roll"
+CONF_KEEPALIVE_INTERVAL = "keepalive_interval"
+CONF_PASSTHROUGH = "passthrough"
+CONF_SPEAKER = "speaker"
+CONF_SAMPLE_RATE = "sample_rate"
+CONF_REQUEST_OUTPUT_FORMAT = "request_output_format"
 
 elevenlabs_stream_ns = cg.esphome_ns.namespace("elevenlabs_stream")
 ElevenLabsStream = elevenlabs_stream_ns.class_("ElevenLabsStream", cg.Component)
+UplinkFormat = elevenlabs_stream_ns.enum("UplinkFormat", is_class=True)
+MicrophoneChannel = elevenlabs_stream_ns.enum("MicrophoneChannel", is_class=True)
+MICROPHONE_CHANNELS = {
+    "mix": MicrophoneChannel.MIX,
+    "left": MicrophoneChannel.LEFT,
+    "right": MicrophoneChannel.RIGHT,
+}
+UPLINK_FORMATS = {
+    "pcm_16000": UplinkFormat.PCM_16000,
+    "ulaw_8000": UplinkFormat.ULAW_8000,
+}
+# Agent output formats a conversation can ask for, by sample rate.
+OUTPUT_FORMATS = {
+    "pcm_16000": 16000,
+    "pcm_22050": 22050,
+    "pcm_24000": 24000,
+    "pcm_44100": 44100,
+    "pcm_48000": 48000,
+}
 ElevenLabsStreamIsRunningCondition = elevenlabs_stream_ns.class_(
     "ElevenLabsStreamIsRunningCondition", Condition
 )
@@ -56,7 +98,31 @@ ElevenLabsStreamReplyingTrigger = elevenlabs_stream_ns.class_(
     "ElevenLabsStreamReplyingTrigger", automation.Trigger.template()
 )
 
-CONFIG_SCHEMA = cv.Schema(
+# Room for the frame that completes the prebuffer on top of the prebuffer itself; agent
+# frames measure around 18KB of PCM.
+PLAYBACK_FRAME_HEADROOM = 32 * 1024
+# Bytes per ms of 16-bit mono audio at the 16 kHz agents default to, unless a format is
+# requested.
+PLAYBACK_BYTES_PER_MS = 32
+
+
+def _validate_playback_buffer(config):
+    jitter = config[CONF_JITTER_BUFFER]
+    if jitter[CONF_MIN_DELAY] > jitter[CONF_MAX_DELAY]:
+        raise cv.Invalid(f"{CONF_MIN_DELAY} must not exceed {CONF_MAX_DELAY}")
+    bytes_per_ms = PLAYBACK_BYTES_PER_MS
+    if CONF_REQUEST_OUTPUT_FORMAT in config:
+        bytes_per_ms = OUTPUT_FORMATS[config[CONF_REQUEST_OUTPUT_FORMAT]] * 2 // 1000
+    prebuffer = jitter[CONF_MAX_DELAY].total_milliseconds * bytes_per_ms
+    if config[CONF_PLAYBACK_BUFFER_SIZE] < prebuffer + PLAYBACK_FRAME_HEADROOM:
+        raise cv.Invalid(
+            f"{CONF_PLAYBACK_BUFFER_SIZE} must hold {CONF_JITTER_BUFFER} {CONF_MAX_DELAY} of audio plus "
+            f"{PLAYBACK_FRAME_HEADROOM} bytes, or prebuffering ends before the cushion is built"
+        )
+    return config
+
+
+CONFIG_SCHEMA = cv.All(cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(ElevenLabsStream),
         cv.Required(CONF_AGENT_ID): cv.templatable(cv.string),
@@ -64,6 +130,94 @@ CONFIG_SCHEMA = cv.Schema(
         cv.Optional(CONF_MICROPHONE): cv.use_id(cg.Parented),
         cv.Optional(CONF_ELEVENLABS_SPEAKER): cv.use_id(speaker.Speaker),
         cv.Optional(CONF_ACTIVATION_SPEAKER): cv.use_id(speaker.Speaker),
+        # The speaker behind elevenlabs_speaker's resampler. Replies whose rate already
+        # matches it are written there directly.
+        cv.Optional(CONF_PASSTHROUGH): cv.Schema(
+            {
+                cv.Required(CONF_SPEAKER): cv.use_id(speaker.Speaker),
+                cv.Optional(CONF_SAMPLE_RATE, default=48000): cv.int_range(min=8000, max=48000),
+            }
+        ),
+        # Overrides the agent's output format per conversation. The agent must allow the
+        # override.
+        cv.Optional(CONF_REQUEST_OUTPUT_FORMAT): cv.one_of(*OUTPUT_FORMATS, lower=True),
+        # Which i2s channel is sent to the agent; both averaged when "mix".
+        cv.Optional(CONF_MICROPHONE_CHANNEL, default="mix"): cv.enum(MICROPHONE_CHANNELS, lower=True),
+        # Keep the microphone open while the agent speaks, so it can be interrupted.
+        # Needs an echo-cancelled microphone channel.
+        cv.Optional(CONF_BARGE_IN, default=False): cv.boolean,
+        # Websocket messages are assembled into one slot while the previous one is
+        # handled. Each slot must fit the largest agent message.
+        cv.Optional(CONF_RECEIVE_SLOTS, default=2): cv.int_range(min=1, max=8),
+        cv.Optional(CONF_RECEIVE_SLOT_SIZE, default="256kB"): cv.All(
+            cv.validate_bytes, cv.int_range(min=16 * 1024)
+        ),
+        # The PCM ring agent audio is decoded into, allocated once at setup, and the
+        # cushion held in it before a reply starts playing.
+        cv.Optional(CONF_PLAYBACK_BUFFER_SIZE, default="128kB"): cv.All(
+            cv.validate_bytes, cv.int_range(min=48 * 1024, max=1024 * 1024)
+        ),
+        # Bounds on that cushion. Within them it follows how late the audio of recent
+        # replies arrived: small on a good link, larger on a poor one.
+        cv.Optional(CONF_JITTER_BUFFER, default={}): cv.Schema(
+            {
+                cv.Optional(CONF_MIN_DELAY, default="100ms"): cv.positive_time_period_milliseconds,
+                cv.Optional(CONF_MAX_DELAY, default="1500ms"): cv.All(
+                    cv.positive_time_period_milliseconds,
+                    cv.Range(max=cv.TimePeriod(milliseconds=5000)),
+                ),
+            }
+        ),
+        # Microphone audio is collected for this long before it is sent as one
+        # websocket frame. 0ms sends every i2s block on its own.
+        cv.Optional(CONF_UPLINK_FRAME_DURATION, default="100ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(max=cv.TimePeriod(milliseconds=1000)),
+        ),
+        # How long a send may wait on a congested link before it is given up on, for
+        # microphone audio and for everything else.
+        cv.Optional(CONF_UPLINK_SEND_TIMEOUT, default="1s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=50)),
+        ),
+        cv.Optional(CONF_CONTROL_SEND_TIMEOUT, default="5s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(min=cv.TimePeriod(milliseconds=100)),
+        ),
+        # Microphone audio kept from the wake word on while the connection is set up,
+        # and sent as soon as the conversation is ready. 0s keeps the microphone closed
+        # until the grace period after connecting has passed.
+        cv.Optional(CONF_CONNECT_BUFFER, default="2s"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(max=cv.TimePeriod(milliseconds=5000)),
+        ),
+        # Microphone audio queued for longer than this is dropped, oldest first.
+        cv.Optional(CONF_UPLINK_MAX_BACKLOG, default="500ms"): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(max=cv.TimePeriod(milliseconds=2000)),
+        ),
+        # The agent's user input format, as set on the agent. The format announced in
+        # the conversation metadata takes precedence once it arrives.
+        cv.Optional(CONF_UPLINK_CODEC, default="pcm_16000"): cv.enum(UPLINK_FORMATS, lower=True),
+        # Local voice activity detection in front of the uplink. Silence is held back
+        # and replaced by a short keepalive frame; speech is sent with the pre-roll
+        # that preceded it. Off unless configured.
+        cv.Optional(CONF_UPLINK_VAD): cv.Schema(
+            {
+                cv.Optional(CONF_THRESHOLD, default="-50dB"): cv.All(
+                    cv.decibel, cv.float_range(min=-90.0, max=0.0)
+                ),
+                cv.Optional(CONF_HANGOVER, default="800ms"): cv.positive_time_period_milliseconds,
+                cv.Optional(CONF_PRE_ROLL, default="300ms"): cv.All(
+                    cv.positive_time_period_milliseconds,
+                    cv.Range(max=cv.TimePeriod(milliseconds=1000)),
+                ),
+                cv.Optional(CONF_KEEPALIVE_INTERVAL, default="1s"): cv.All(
+                    cv.positive_time_period_milliseconds,
+                    cv.Range(min=cv.TimePeriod(milliseconds=100)),
+                ),
+            }
+        ),
         cv.Optional(CONF_ON_START): automation.validate_automation(
             {
                 cv.GenerateID(CONF_TRIGGER_ID): cv.declare_id(ElevenLabsStreamStartTrigger),
@@ -95,7 +249,7 @@ CONFIG_SCHEMA = cv.Schema(
             }
         ),
     }
-).extend(cv.COMPONENT_SCHEMA)
+).extend(cv.COMPONENT_SCHEMA), _validate_playback_buffer)
 
 
 async def to_code(config):
@@ -126,6 +280,42 @@ async def to_code(config):
         activation_speaker = await cg.get_variable(config[CONF_ACTIVATION_SPEAKER])
         cg.add(var.set_activation_speaker(activation_speaker))
 
+    if CONF_PASSTHROUGH in config:
+        passthrough = config[CONF_PASSTHROUGH]
+        passthrough_speaker = await cg.get_variable(passthrough[CONF_SPEAKER])
+        cg.add(var.set_passthrough_speaker(passthrough_speaker, passthrough[CONF_SAMPLE_RATE]))
+
+    if CONF_REQUEST_OUTPUT_FORMAT in config:
+        cg.add(var.set_request_output_format(config[CONF_REQUEST_OUTPUT_FORMAT]))
+
+    cg.add(var.set_receive_slots(config[CONF_RECEIVE_SLOTS]))
+    cg.add(var.set_receive_slot_size(config[CONF_RECEIVE_SLOT_SIZE]))
+    cg.add(var.set_playback_buffer_size(config[CONF_PLAYBACK_BUFFER_SIZE]))
+    cg.add(
+        var.set_jitter_buffer(
+            config[CONF_JITTER_BUFFER][CONF_MIN_DELAY].total_milliseconds,
+            config[CONF_JITTER_BUFFER][CONF_MAX_DELAY].total_milliseconds,
+        )
+    )
+    cg.add(var.set_uplink_frame_duration(config[CONF_UPLINK_FRAME_DURATION].total_milliseconds))
+    cg.add(var.set_uplink_codec(config[CONF_UPLINK_CODEC]))
+    cg.add(var.set_microphone_channel(config[CONF_MICROPHONE_CHANNEL]))
+    cg.add(var.set_barge_in(config[CONF_BARGE_IN]))
+    cg.add(var.set_uplink_send_timeout(config[CONF_UPLINK_SEND_TIMEOUT].total_milliseconds))
+    cg.add(var.set_control_send_timeout(config[CONF_CONTROL_SEND_TIMEOUT].total_milliseconds))
+    cg.add(var.set_uplink_max_backlog(config[CONF_UPLINK_MAX_BACKLOG].total_milliseconds))
+    cg.add(var.set_connect_buffer(config[CONF_CONNECT_BUFFER].total_milliseconds))
+    if CONF_UPLINK_VAD in config:
+        vad = config[CONF_UPLINK_VAD]
+        cg.add(
+            var.set_uplink_vad(
+                vad[CONF_THRESHOLD],
+                vad[CONF_HANGOVER].total_milliseconds,
+                vad[CONF_PRE_ROLL].total_milliseconds,
+                vad[CONF_KEEPALIVE_INTERVAL].total_milliseconds,
+            )
+        )
+
     # Register triggers
     for conf in config.get(CONF_ON_START, []):
         trigger = cg.new_Pvariable(conf[CONF_TRIGGER_ID])
@@ -0,0 +1,91 @@
+// audio_frame_scanner.cpp
+#include "audio_frame_scanner.h"
+#include "esphome/core/log.h"
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+static const char *TAG = "audio_frame_scanner";
+
+static const char AUDIO_KEY[] = "\"audio_base_64\"";
+static const size_t AUDIO_KEY_LEN = sizeof(AUDIO_KEY) - 1;
+
+ptrdiff_t AudioFrameScanner::find_payload(const char *data, size_t len) {
+  // Hand-rolled rather than memmem(), which is a GNU extension and not dependable on
+  // ESP-IDF. The key appears early in the frame, so this scans a few bytes in practice.
+  const char *end = data + len;
+  const char *p = data;
+  while (p + AUDIO_KEY_LEN <= end) {
+    p = static_cast<const char *>(memchr(p, '"', end - p - AUDIO_KEY_LEN + 1));
+    if (p == nullptr) {
+      return -1;
+    }
+    if (memcmp(p, AUDIO_KEY, AUDIO_KEY_LEN) == 0) {
+      p += AUDIO_KEY_LEN;
+      while (p < end && *p != ':') p++;  // key -> colon
+      while (p < end && *p != '"') p++;  // colon -> opening quote
+      return p < end ? (p + 1) - data : -1;
+    }
+    p++;
+  }
+  return -1;
+}
+
+bool AudioFrameScanner::on_stream_begin(const uint8_t *data, size_t len, size_t total_len) {
+  if (!this->enabled_.load()) {
+    return false;
+  }
+  const char *chars = reinterpret_cast<const char *>(data);
+  ptrdiff_t start = find_payload(chars, len);
+  if (start < 0) {
+    return false;
+  }
+  if (this->on_begin_ && !this->on_begin_(total_len)) {
+    ESP_LOGV(TAG, "Audio frame of %zu bytes declined; assembling it", total_len);
+    return false;
+  }
+  ESP_LOGV(TAG, "Audio frame opens at offset %d; streaming it", static_cast<int>(start));
+  this->state_ = State::PAYLOAD;
+  this->payload_len_ = 0;
+  this->scan(chars + start, len - start);
+  return true;
+}
+
+void AudioFrameScanner::on_stream_data(const uint8_t *data, size_t len) {
+  this->scan(reinterpret_cast<const char *>(data), len);
+}
+
+// Passes payload characters on up to the closing quote. Whatever follows it -- the
+// event_id and the type -- is not needed for playback and is skipped.
+void AudioFrameScanner::scan(const char *data, size_t len) {
+  if (this->state_ != State::PAYLOAD || len == 0) {
+    return;
+  }
+  const char *quote = static_cast<const char *>(memchr(data, '"', len));
+  size_t run = quote != nullptr ? quote - data : len;
+  if (run > 0) {
+    this->payload_len_ += run;
+    if (this->on_payload_ && !this->on_payload_(data, run)) {
+      this->state_ = State::FAILED;
+      return;
+    }
+  }
+  if (quote != nullptr) {
+    this->state_ = State::TRAILER;
+  }
+}
+
+void AudioFrameScanner::on_stream_end(bool complete) {
+  bool payload_complete = complete && this->state_ == State::TRAILER;
+  if (this->state_ != State::FAILED && !payload_complete) {
+    ESP_LOGW(TAG, "Audio frame cut short after %zu payload characters", this->payload_len_);
+  }
+  if (this->state_ != State::FAILED && this->on_end_) {
+    this->on_end_(this->payload_len_, payload_complete);
+  }
+  this->state_ = State::IDLE;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,62 @@
+// audio_frame_scanner.h
+#pragma once
+#include <cstddef>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "websocket_client.h"
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Pulls the base64 payload out of agent audio frames while they are still arriving.
+//
+// An audio frame is {"audio_event":{"audio_base_64":"<~100KB>",...},"type":"audio"}, and
+// the fast path in parse_json_message_from_buffer could only look at it once the last
+// fragment had been assembled -- so the first sample of every frame waited for the last
+// TCP segment, and every frame needed a receive slot big enough to hold it whole.
+//
+// The scanner looks for the audio key in the first fragment of each message. If it is
+// there, the scanner takes the message and hands every payload character on as it
+// arrives, so decoding starts with the first fragment and nothing is buffered. If it is
+// not -- control messages, or an audio frame laid out differently -- the message is
+// assembled and parsed as before.
+class AudioFrameScanner : public WebsocketStreamHandler {
+ public:
+  // Gets the size of the frame in bytes, 0 if not known yet. Returning false declines
+  // the frame, which is then assembled and parsed whole.
+  void set_on_begin(std::function<bool(size_t)> &&callback) { this->on_begin_ = std::move(callback); }
+  // Gets each run of payload characters. Returning false abandons the rest of the frame.
+  void set_on_payload(std::function<bool(const char *, size_t)> &&callback) {
+    this->on_payload_ = std::move(callback);
+  }
+  // Gets the payload length, and whether the payload was received up to its closing quote.
+  void set_on_end(std::function<void(size_t, bool)> &&callback) { this->on_end_ = std::move(callback); }
+
+  // While disabled every frame is left to be assembled and parsed whole, event_id and
+  // all. Safe to call from any task.
+  void set_enabled(bool enabled) { this->enabled_.store(enabled); }
+
+  bool on_stream_begin(const uint8_t *data, size_t len, size_t total_len) override;
+  void on_stream_data(const uint8_t *data, size_t len) override;
+  void on_stream_end(bool complete) override;
+
+  // Offset of the first payload character in a fragment, or -1 if the fragment does not
+  // open an audio frame. Shared with the assembled fast path.
+  static ptrdiff_t find_payload(const char *data, size_t len);
+
+ protected:
+  void scan(const char *data, size_t len);
+
+  std::function<bool(size_t)> on_begin_;
+  std::function<bool(const char *, size_t)> on_payload_;
+  std::function<void(size_t, bool)> on_end_;
+
+  enum class State : uint8_t { IDLE, PAYLOAD, TRAILER, FAILED };
+  State state_{State::IDLE};
+  std::atomic<bool> enabled_{true};
+  size_t payload_len_{0};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -1,88 +1,236 @@
 #include "base64.h"
-#include <mbedtls/base64.h>
 #include "esphome/core/log.h"
 #include <string>
 #include <cstring>
 #include <memory>
-#include <esp_heap_caps.h>
+#include <algorithm>
 
 namespace esphome {
 namespace elevenlabs_stream {
 
 static const char* TAG = "base64";
 
-// Base64 encoding function with error handling
+// The codec is our own rather than mbedtls. mbedtls_base64_* is written for PEM and
+// key material: it validates and skips whitespace one character at a time and has to
+// be called twice, once just to learn the output size. Every microphone chunk and every
+// agent audio frame goes through here, on the core that also runs the websocket task,
+// so throughput matters more than generality.
+//
+// Both directions are table driven and work a machine word at a time (SWAR). Encoding
+// packs two triples into one 64-bit store of eight characters. Decoding looks each
+// character up in one of four tables whose entries are already shifted into their
+// place in the output word, so a quad is four loads and three ORs, and a single test
+// of the top byte catches an invalid character anywhere in it.
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__, "base64 word stores assume a little-endian target");
+
+static constexpr char ENCODE_TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// Any bit set in the top byte of a decoded word marks an invalid character.
+static constexpr uint32_t DECODE_INVALID = 0x01FFFFFF;
+static constexpr uint32_t DECODE_INVALID_MASK = 0xFF000000;
+
+struct DecodeTables {
+  uint32_t quad[4][256];
+};
+
+// Entry [k][c] is the 6-bit value of character c, positioned for the k-th character of
+// a quad in the little-endian word holding the three output bytes.
+static constexpr DecodeTables make_decode_tables() {
+  DecodeTables tables{};
+  for (int k = 0; k < 4; k++) {
+    for (int c = 0; c < 256; c++) {
+      tables.quad[k][c] = DECODE_INVALID;
+    }
+  }
+  for (uint32_t v = 0; v < 64; v++) {
+    uint8_t c = static_cast<uint8_t>(ENCODE_TABLE[v]);
+    tables.quad[0][c] = v << 2;
+    tables.quad[1][c] = (v >> 4) | ((v & 0x0F) << 12);
+    tables.quad[2][c] = ((v >> 2) << 8) | ((v & 0x03) << 22);
+    tables.quad[3][c] = v << 16;
+  }
+  return tables;
+}
+
+static constexpr DecodeTables DECODE_TABLES = make_decode_tables();
+
+static inline uint32_t decode_quad(const uint8_t *in) {
+  return DECODE_TABLES.quad[0][in[0]] | DECODE_TABLES.quad[1][in[1]] | DECODE_TABLES.quad[2][in[2]] |
+         DECODE_TABLES.quad[3][in[3]];
+}
+
+static inline uint32_t encode_triple(const uint8_t *in) {
+  uint32_t w = (static_cast<uint32_t>(in[0]) << 16) | (static_cast<uint32_t>(in[1]) << 8) | in[2];
+  return static_cast<uint32_t>(ENCODE_TABLE[w >> 18]) | (static_cast<uint32_t>(ENCODE_TABLE[(w >> 12) & 0x3F]) << 8) |
+         (static_cast<uint32_t>(ENCODE_TABLE[(w >> 6) & 0x3F]) << 16) |
+         (static_cast<uint32_t>(ENCODE_TABLE[w & 0x3F]) << 24);
+}
+
+size_t base64_encode_into(const uint8_t *data, size_t len, char *out) {
+  char *o = out;
+  size_t i = 0;
+  for (; i + 6 <= len; i += 6, o += 8) {
+    uint64_t chars = static_cast<uint64_t>(encode_triple(data + i)) |
+                     (static_cast<uint64_t>(encode_triple(data + i + 3)) << 32);
+    memcpy(o, &chars, sizeof(chars));
+  }
+  for (; i + 3 <= len; i += 3, o += 4) {
+    uint32_t chars = encode_triple(data + i);
+    memcpy(o, &chars, sizeof(chars));
+  }
+  size_t rest = len - i;
+  if (rest > 0) {
+    uint32_t w = static_cast<uint32_t>(data[i]) << 16;
+    if (rest == 2) {
+      w |= static_cast<uint32_t>(data[i + 1]) << 8;
+    }
+    o[0] = ENCODE_TABLE[w >> 18];
+    o[1] = ENCODE_TABLE[(w >> 12) & 0x3F];
+    o[2] = rest == 2 ? ENCODE_TABLE[(w >> 6) & 0x3F] : '=';
+    o[3] = '=';
+    o += 4;
+  }
+  return o - out;
+}
+
+bool base64_decode_quads(const char *data, size_t len, uint8_t *out, size_t &out_len) {
+  out_len = 0;
+  if (len % 4 != 0) {
+    return false;
+  }
+  if (len == 0) {
+    return true;
+  }
+  const uint8_t *in = reinterpret_cast<const uint8_t *>(data);
+  uint8_t *o = out;
+
+  // Every quad but the last is guaranteed unpadded; two of them per iteration.
+  size_t body = len - 4;
+  size_t i = 0;
+  for (; i + 8 <= body; i += 8, o += 6) {
+    uint32_t x0 = decode_quad(in + i);
+    uint32_t x1 = decode_quad(in + i + 4);
+    if ((x0 | x1) & DECODE_INVALID_MASK) {
+      return false;
+    }
+    o[0] = x0;
+    o[1] = x0 >> 8;
+    o[2] = x0 >> 16;
+    o[3] = x1;
+    o[4] = x1 >> 8;
+    o[5] = x1 >> 16;
+  }
+  for (; i < body; i += 4, o += 3) {
+    uint32_t x = decode_quad(in + i);
+    if (x & DECODE_INVALID_MASK) {
+      return false;
+    }
+    o[0] = x;
+    o[1] = x >> 8;
+    o[2] = x >> 16;
+  }
+
+  // The last quad may carry one or two padding characters.
+  const uint8_t *q = in + body;
+  if (q[3] != '=') {
+    uint32_t x = decode_quad(q);
+    if (x & DECODE_INVALID_MASK) {
+      return false;
+    }
+    o[0] = x;
+    o[1] = x >> 8;
+    o[2] = x >> 16;
+    o += 3;
+  } else if (q[2] != '=') {
+    uint32_t x = DECODE_TABLES.quad[0][q[0]] | DECODE_TABLES.quad[1][q[1]] | DECODE_TABLES.quad[2][q[2]];
+    if (x & DECODE_INVALID_MASK) {
+      return false;
+    }
+    o[0] = x;
+    o[1] = x >> 8;
+    o += 2;
+  } else {
+    uint32_t x = DECODE_TABLES.quad[0][q[0]] | DECODE_TABLES.quad[1][q[1]];
+    if (x & DECODE_INVALID_MASK) {
+      return false;
+    }
+    o[0] = x;
+    o += 1;
+  }
+  out_len = o - out;
+  return true;
+}
+
 std::string base64_encode(const uint8_t* data, size_t len) {
   if (!data || len == 0) {
     return "";
   }
-  size_t output_len = 0;
-  int ret = mbedtls_base64_encode(nullptr, 0, &output_len, data, len);
-  if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) {
-    ESP_LOGE(TAG, "Failed to calculate base64 encode buffer size: %d", ret);
-    return "";
+  std::string result(base64_encoded_size(len), '\0');
+  base64_encode_into(data, len, &result[0]);
+  return result;
+}
+
+void Base64Decoder::reset() {
+  this->carry_len_ = 0;
+  this->padded_ = false;
+}
+
+// Decodes a run of whole quads into out. len must be a multiple of four.
+bool Base64Decoder::decode_quads(const char *data, size_t len, uint8_t *out, size_t &written) {
+  written = 0;
+  if (len == 0) {
+    return true;
   }
-  std::string result(output_len, '\0');
-  ret = mbedtls_base64_encode(reinterpret_cast<unsigned char*>(&result[0]), output_len, &output_len, data, len);
-  if (ret != 0) {
-    ESP_LOGE(TAG, "Failed to encode base64: %d", ret);
-    return "";
+  if (this->padded_) {
+    ESP_LOGE(TAG, "Base64Decoder: Data after padding");
+    return false;
   }
-  result.resize(output_len);
-  return result;
+  if (!base64_decode_quads(data, len, out, written)) {
+    ESP_LOGE(TAG, "Base64Decoder: Invalid character in %zu chars of input", len);
+    return false;
+  }
+  this->padded_ = data[len - 1] == '=';
+  return true;
 }
 
-// Base64 decoding function with error handling, using unique_ptr for large buffer efficiency
+bool Base64Decoder::feed_into(const char *data, size_t len, uint8_t *out, size_t out_cap, size_t &consumed,
+                              size_t &written) {
+  consumed = 0;
+  written = 0;
+  if (data == nullptr || len == 0 || out_cap < 3) {
+    return true;
+  }
 
-// Returns nullptr on failure, otherwise buffer must be freed by caller with heap_caps_free
-uint8_t* base64_decode(const char* base64_data, size_t& out_len) {
-  out_len = 0;
-  if (!base64_data) {
-    ESP_LOGE(TAG, "base64_decode: input is null");
-    return nullptr;
-  }
-  size_t input_len = strlen(base64_data);
-  if (input_len == 0) {
-    return nullptr;
-  }
-  size_t required_output_len = 0;
-  int ret = mbedtls_base64_decode(nullptr, 0, &required_output_len, (const unsigned char*)base64_data, input_len);
-  if (ret != MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL) {
-    ESP_LOGE(TAG, "base64_decode: Failed to get output length: %d", ret);
-    return nullptr;
-  }
-  
-  // Log PSRAM before allocation
-  size_t psram_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-  ESP_LOGD(TAG, "base64_decode: Allocating %zu bytes, PSRAM Free=%zuKB", 
-           required_output_len, psram_before / 1024);
-  
-  uint8_t* buffer = (uint8_t*) heap_caps_malloc(required_output_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-  if (!buffer) {
-    size_t psram_after_fail = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    ESP_LOGE(TAG, "base64_decode: Failed to allocate %zu bytes in PSRAM (Free=%zuKB)", 
-             required_output_len, psram_after_fail / 1024);
-    return nullptr;
-  }
-  
-  // Log PSRAM after successful allocation
-  size_t psram_after = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-  size_t psram_delta = psram_before - psram_after;
-  ESP_LOGD(TAG, "base64_decode: Allocated successfully, PSRAM Free=%zuKB (-%zuKB)", 
-           psram_after / 1024, psram_delta / 1024);
-  
-  if (psram_after < 1024 * 1024) {
-    ESP_LOGW(TAG, "base64_decode: LOW MEMORY WARNING: PSRAM Free=%zuKB", psram_after / 1024);
-  }
-  size_t output_len = 0;
-  ret = mbedtls_base64_decode(buffer, required_output_len, &output_len, (const unsigned char*)base64_data, input_len);
-  if (ret != 0) {
-    ESP_LOGE(TAG, "base64_decode: Failed to decode: %d", ret);
-    heap_caps_free(buffer);
-    return nullptr;
-  }
-  out_len = output_len;
-  return buffer;
+  // Complete the quad left over from the previous chunk first.
+  if (this->carry_len_ > 0) {
+    while (this->carry_len_ < 4 && consumed < len) {
+      this->carry_[this->carry_len_++] = data[consumed++];
+    }
+    if (this->carry_len_ < 4) {
+      return true;
+    }
+    this->carry_len_ = 0;
+    if (!this->decode_quads(this->carry_, 4, out, written)) {
+      return false;
+    }
+  }
+
+  size_t quads_in = (len - consumed) / 4;
+  size_t quads = std::min(quads_in, (out_cap - written) / 3);
+  size_t n = 0;
+  if (!this->decode_quads(data + consumed, quads * 4, out + written, n)) {
+    return false;
+  }
+  consumed += quads * 4;
+  written += n;
+
+  // Only once every whole quad is decoded is the remainder a genuine partial quad.
+  if (quads == quads_in) {
+    while (consumed < len) {
+      this->carry_[this->carry_len_++] = data[consumed++];
+    }
+  }
+  return true;
 }
 
 } // namespace elevenlabs_stream
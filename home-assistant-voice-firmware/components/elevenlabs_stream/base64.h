@@ -10,8 +10,49 @@ namespace elevenlabs_stream {
 
 
 std::string base64_encode(const uint8_t* data, size_t len);
-// Returns nullptr on failure, otherwise buffer must be freed by caller with heap_caps_free
-uint8_t* base64_decode(const char* base64_data, size_t& out_len);
+
+// Number of characters base64_encode_into() writes for len bytes, padding included.
+inline size_t base64_encoded_size(size_t len) { return (len + 2) / 3 * 4; }
+// Encodes len bytes into out, which must hold base64_encoded_size(len) characters. No
+// terminator is written. Returns the number of characters written.
+size_t base64_encode_into(const uint8_t *data, size_t len, char *out);
+// Decodes whole quads; len must be a multiple of four and only the last quad may be
+// padded. out must hold len / 4 * 3 bytes. Returns false on an invalid character.
+bool base64_decode_quads(const char *data, size_t len, uint8_t *out, size_t &out_len);
+
+// Stateful decoder for the agent's audio frames.
+//
+// Every frame used to be decoded by a free function that measured the input with
+// strlen, asked mbedtls for the output size, and malloc'd a fresh PSRAM buffer that the
+// caller freed again a moment later. At several ~100KB frames a second that churn is
+// what fragmented PSRAM. The decoder owns no buffer at all: it writes into whatever span
+// the caller hands it -- in practice a writable span of the playback ring, so decoded
+// PCM lands where the speaker reads it.
+//
+// Input may arrive in arbitrary chunks. A quad split across two chunks is carried over
+// to the next call, so callers can hand over whatever they have as it arrives.
+class Base64Decoder {
+ public:
+  // Starts a new frame.
+  void reset();
+  // Decodes as much of a chunk as fits into out. consumed and written report the input
+  // characters used and the bytes produced; the caller calls again with the rest once
+  // it has more room. out_cap must be at least 3. Returns false on malformed input, after
+  // which the frame should be abandoned with reset().
+  bool feed_into(const char *data, size_t len, uint8_t *out, size_t out_cap, size_t &consumed, size_t &written);
+  // Ends the frame. Returns false if a partial quad was left over.
+  bool finish() const { return this->carry_len_ == 0; }
+
+ protected:
+  bool decode_quads(const char *data, size_t len, uint8_t *out, size_t &written);
+
+  // Characters of an incomplete quad left over from the previous chunk.
+  char carry_[4];
+  uint8_t carry_len_{0};
+  // Set once a padded quad has been decoded. Padding only ever ends a frame, so any
+  // input after it is malformed.
+  bool padded_{false};
+};
 
 } // namespace elevenlabs_stream
 } // namespace esphome
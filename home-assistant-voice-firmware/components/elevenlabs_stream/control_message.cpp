@@ -0,0 +1,427 @@
+// control_message.cpp
+#include "control_message.h"
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Deepest nesting accepted. ElevenLabs control messages use two levels; anything far
+// beyond that is left to ArduinoJson rather than risk the stack.
+static const int MAX_DEPTH = 8;
+
+// Reads a JSON number at p and advances past it. Leaves p alone and returns false if
+// there is no number there.
+static bool parse_json_number(const char *&p, const char *end, double &out) {
+  const char *start = p;
+  bool negative = false;
+  if (p < end && *p == '-') {
+    negative = true;
+    p++;
+  }
+  double value = 0.0;
+  size_t digits = 0;
+  while (p < end && *p >= '0' && *p <= '9') {
+    value = value * 10.0 + (*p++ - '0');
+    digits++;
+  }
+  if (p < end && *p == '.') {
+    p++;
+    double scale = 0.1;
+    while (p < end && *p >= '0' && *p <= '9') {
+      value += (*p++ - '0') * scale;
+      scale *= 0.1;
+      digits++;
+    }
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negative_exponent = false;
+    if (p < end && (*p == '+' || *p == '-')) {
+      negative_exponent = *p++ == '-';
+    }
+    int exponent = 0;
+    const char *exponent_start = p;
+    while (p < end && *p >= '0' && *p <= '9' && exponent < 400) {
+      exponent = exponent * 10 + (*p++ - '0');
+    }
+    if (p == exponent_start) {
+      p = start;
+      return false;
+    }
+    for (int i = 0; i < exponent; i++) {
+      value = negative_exponent ? value / 10.0 : value * 10.0;
+    }
+  }
+  if (digits == 0) {
+    p = start;
+    return false;
+  }
+  out = negative ? -value : value;
+  return true;
+}
+
+namespace {
+
+// Single-pass reader over one message. Each parse_* method consumes exactly one JSON
+// value and returns false as soon as the input stops being valid JSON.
+class ControlMessageReader {
+ public:
+  ControlMessageReader(const char *data, size_t len, ControlMessage &out) : p_(data), end_(data + len), out_(out) {}
+
+  bool parse() {
+    this->skip_whitespace();
+    if (this->p_ == this->end_ || *this->p_ != '{' || !this->parse_object(1)) {
+      return false;
+    }
+    this->skip_whitespace();
+    return this->p_ == this->end_;
+  }
+
+ protected:
+  void skip_whitespace() {
+    while (this->p_ < this->end_ && (*this->p_ == ' ' || *this->p_ == '\n' || *this->p_ == '\r' || *this->p_ == '\t'))
+      this->p_++;
+  }
+
+  bool consume(char c) {
+    this->skip_whitespace();
+    if (this->p_ == this->end_ || *this->p_ != c) {
+      return false;
+    }
+    this->p_++;
+    return true;
+  }
+
+  bool parse_object(int depth) {
+    if (depth > MAX_DEPTH || !this->consume('{')) {
+      return false;
+    }
+    if (this->consume('}')) {
+      return true;
+    }
+    do {
+      JsonSpan key;
+      this->skip_whitespace();
+      if (!this->parse_string(key) || !this->consume(':') || !this->parse_member(key, depth)) {
+        return false;
+      }
+    } while (this->consume(','));
+    return this->consume('}');
+  }
+
+  bool parse_array(int depth) {
+    if (depth > MAX_DEPTH || !this->consume('[')) {
+      return false;
+    }
+    if (this->consume(']')) {
+      return true;
+    }
+    do {
+      if (!this->parse_value(depth)) {
+        return false;
+      }
+    } while (this->consume(','));
+    return this->consume(']');
+  }
+
+  // Parses the value of `key` and records it if it is one of the fields handlers use.
+  bool parse_member(const JsonSpan &key, int depth) {
+    this->skip_whitespace();
+    if (this->p_ == this->end_) {
+      return false;
+    }
+    char c = *this->p_;
+    if (c == '"') {
+      JsonSpan value;
+      if (!this->parse_string(value)) {
+        return false;
+      }
+      this->record_string(key, value, depth);
+      return true;
+    }
+    if (c == '-' || (c >= '0' && c <= '9')) {
+      double value;
+      if (!this->parse_number(value)) {
+        return false;
+      }
+      this->record_number(key, value);
+      return true;
+    }
+    if (c == '{') {
+      this->record_object(key);
+    }
+    return this->parse_value(depth);
+  }
+
+  bool parse_value(int depth) {
+    this->skip_whitespace();
+    if (this->p_ == this->end_) {
+      return false;
+    }
+    switch (*this->p_) {
+      case '{':
+        return this->parse_object(depth + 1);
+      case '[':
+        return this->parse_array(depth + 1);
+      case '"': {
+        JsonSpan ignored;
+        return this->parse_string(ignored);
+      }
+      case 't':
+        return this->parse_literal("true");
+      case 'f':
+        return this->parse_literal("false");
+      case 'n':
+        return this->parse_literal("null");
+      default: {
+        double ignored;
+        return this->parse_number(ignored);
+      }
+    }
+  }
+
+  // Reads a string, leaving `out` spanning its contents between the quotes. Escapes are
+  // stepped over but not decoded; see JsonSpan.
+  bool parse_string(JsonSpan &out) {
+    if (this->p_ == this->end_ || *this->p_ != '"') {
+      return false;
+    }
+    const char *start = ++this->p_;
+    while (this->p_ < this->end_) {
+      char c = *this->p_;
+      if (c == '"') {
+        out.data = start;
+        out.len = this->p_ - start;
+        this->p_++;
+        return true;
+      }
+      if (static_cast<uint8_t>(c) < 0x20) {
+        return false;
+      }
+      if (c == '\\') {
+        this->p_++;
+        if (this->p_ == this->end_) {
+          return false;
+        }
+        if (*this->p_ == 'u') {
+          if (this->end_ - this->p_ < 5) {
+            return false;
+          }
+          this->p_ += 4;
+        }
+      }
+      this->p_++;
+    }
+    return false;
+  }
+
+  bool parse_number(double &out) { return parse_json_number(this->p_, this->end_, out); }
+
+  bool parse_literal(const char *literal) {
+    size_t len = strlen(literal);
+    if (static_cast<size_t>(this->end_ - this->p_) < len || memcmp(this->p_, literal, len) != 0) {
+      return false;
+    }
+    this->p_ += len;
+    return true;
+  }
+
+  void record_object(const JsonSpan &key) {
+    if (key.equals("conversation_initiation_metadata_event")) {
+      this->out_.metadata_event = true;
+    } else if (key.equals("audio_event")) {
+      this->out_.audio_event = true;
+    } else if (key.equals("user_transcription_event")) {
+      this->out_.transcript_event = true;
+    } else if (key.equals("agent_response_event")) {
+      this->out_.response_event = true;
+    } else if (key.equals("vad_score_event")) {
+      this->out_.vad_event = true;
+    } else if (key.equals("interruption_event")) {
+      this->out_.interruption_event = true;
+    } else if (key.equals("ping_event")) {
+      this->out_.ping_event = true;
+    } else if (key.equals("agent_tool_response")) {
+      this->out_.tool_response_event = true;
+    }
+  }
+
+  void record_string(const JsonSpan &key, const JsonSpan &value, int depth) {
+    // Only the top-level type names the message; tool payloads may carry their own.
+    if (depth == 1 && key.equals("type")) {
+      this->out_.type = value;
+    } else if (key.equals("conversation_id")) {
+      this->out_.conversation_id = value;
+    } else if (key.equals("agent_output_audio_format")) {
+      this->out_.agent_output_audio_format = value;
+    } else if (key.equals("user_input_audio_format")) {
+      this->out_.user_input_audio_format = value;
+    } else if (key.equals("audio_base_64")) {
+      this->out_.audio_base_64 = value;
+    } else if (key.equals("user_transcript")) {
+      this->out_.user_transcript = value;
+    } else if (key.equals("agent_response")) {
+      this->out_.agent_response = value;
+    } else if (key.equals("tool_name")) {
+      this->out_.tool_name = value;
+    }
+  }
+
+  void record_number(const JsonSpan &key, double value) {
+    if (key.equals("vad_score")) {
+      this->out_.vad_score = static_cast<float>(value);
+      this->out_.has_vad_score = true;
+    } else if (key.equals("event_id") && value >= 0) {
+      this->out_.event_id = static_cast<uint32_t>(value);
+      this->out_.has_event_id = true;
+    } else if (key.equals("ping_ms") && value >= 0) {
+      this->out_.ping_ms = static_cast<uint32_t>(value);
+    }
+  }
+
+  const char *p_;
+  const char *end_;
+  ControlMessage &out_;
+};
+
+JsonSpan span_of(JsonVariant value) {
+  const char *s = value.as<const char *>();
+  return s != nullptr ? JsonSpan{s, strlen(s)} : JsonSpan{};
+}
+
+}  // namespace
+
+// Longest message scan_frequent_control_message() looks at. vad_score and ping frames
+// are well under 100 bytes; anything longer is not one of them.
+static const size_t FREQUENT_MESSAGE_MAX_LEN = 256;
+
+// First occurrence of `needle` in [data, data + len), or nullptr.
+static const char *find_bytes(const char *data, size_t len, const char *needle) {
+  size_t needle_len = strlen(needle);
+  const char *end = data + len;
+  for (const char *p = data; p + needle_len <= end; p++) {
+    p = static_cast<const char *>(memchr(p, needle[0], end - p - needle_len + 1));
+    if (p == nullptr) {
+      return nullptr;
+    }
+    if (memcmp(p, needle, needle_len) == 0) {
+      return p;
+    }
+  }
+  return nullptr;
+}
+
+// Reads the number following `key` (quoted, with its colon), allowing whitespace after
+// the colon.
+static bool scan_number_after(const char *data, size_t len, const char *key, double &out) {
+  const char *p = find_bytes(data, len, key);
+  if (p == nullptr) {
+    return false;
+  }
+  const char *end = data + len;
+  p += strlen(key);
+  while (p < end && *p == ' ') p++;
+  return parse_json_number(p, end, out);
+}
+
+bool scan_frequent_control_message(const char *data, size_t len, ControlMessage &out) {
+  if (data == nullptr || len > FREQUENT_MESSAGE_MAX_LEN) {
+    return false;
+  }
+  static const char VAD_TYPE[] = "\"type\":\"vad_score\"";
+  static const char PING_TYPE[] = "\"type\":\"ping\"";
+  const char *type = nullptr;
+  double value;
+  if ((type = find_bytes(data, len, VAD_TYPE)) != nullptr) {
+    if (!scan_number_after(data, len, "\"vad_score\":", value)) {
+      return false;
+    }
+    out = ControlMessage{};
+    out.type = JsonSpan{type + 8, strlen("vad_score")};
+    out.vad_event = true;
+    out.has_vad_score = true;
+    out.vad_score = static_cast<float>(value);
+  } else if ((type = find_bytes(data, len, PING_TYPE)) != nullptr) {
+    if (!scan_number_after(data, len, "\"event_id\":", value) || value < 0) {
+      return false;
+    }
+    out = ControlMessage{};
+    out.type = JsonSpan{type + 8, strlen("ping")};
+    out.ping_event = true;
+    out.has_event_id = true;
+    out.event_id = static_cast<uint32_t>(value);
+    if (scan_number_after(data, len, "\"ping_ms\":", value) && value >= 0) {
+      out.ping_ms = static_cast<uint32_t>(value);
+    }
+  } else {
+    return false;
+  }
+  out.raw = JsonSpan{data, len};
+  return true;
+}
+
+bool parse_control_message(const char *data, size_t len, ControlMessage &out) {
+  out = ControlMessage{};
+  if (data == nullptr || !ControlMessageReader(data, len, out).parse()) {
+    out = ControlMessage{};
+    return false;
+  }
+  return true;
+}
+
+void control_message_from_json(JsonObject root, ControlMessage &out) {
+  out = ControlMessage{};
+  out.type = span_of(root["type"]);
+
+  JsonObject metadata = root["conversation_initiation_metadata_event"];
+  if (metadata) {
+    out.metadata_event = true;
+    out.conversation_id = span_of(metadata["conversation_id"]);
+    out.agent_output_audio_format = span_of(metadata["agent_output_audio_format"]);
+    out.user_input_audio_format = span_of(metadata["user_input_audio_format"]);
+  }
+  JsonObject audio = root["audio_event"];
+  if (audio) {
+    out.audio_event = true;
+    JsonString audio_base64 = audio["audio_base_64"].as<JsonString>();
+    if (!audio_base64.isNull()) {
+      out.audio_base_64 = JsonSpan{audio_base64.c_str(), audio_base64.size()};
+    }
+  }
+  JsonObject transcript = root["user_transcription_event"];
+  if (transcript) {
+    out.transcript_event = true;
+    out.user_transcript = span_of(transcript["user_transcript"]);
+  }
+  JsonObject response = root["agent_response_event"];
+  if (response) {
+    out.response_event = true;
+    out.agent_response = span_of(response["agent_response"]);
+  }
+  JsonObject vad = root["vad_score_event"];
+  if (vad) {
+    out.vad_event = true;
+    out.has_vad_score = vad["vad_score"].is<float>();
+    out.vad_score = vad["vad_score"] | 0.0f;
+  }
+  out.interruption_event = !root["interruption_event"].isNull();
+  JsonObject ping = root["ping_event"];
+  if (ping) {
+    out.ping_event = true;
+    out.ping_ms = ping["ping_ms"] | 0;
+  }
+  JsonObject tool_response = root["agent_tool_response"];
+  if (tool_response) {
+    out.tool_response_event = true;
+    out.tool_name = span_of(tool_response["tool_name"]);
+  }
+  JsonObject interruption = root["interruption_event"];
+  for (JsonObject event : {audio, ping, interruption}) {
+    if (event && event["event_id"].is<uint32_t>()) {
+      out.event_id = event["event_id"].as<uint32_t>();
+      out.has_event_id = true;
+    }
+  }
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
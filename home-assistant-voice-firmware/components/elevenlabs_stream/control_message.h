@@ -0,0 +1,92 @@
+// control_message.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "json.h"
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// A string value inside a received message, by pointer and length. Escapes are left as
+// they arrived: every field read through a span is an identifier, a format name or text
+// that is only logged.
+struct JsonSpan {
+  const char *data{nullptr};
+  size_t len{0};
+
+  bool present() const { return this->data != nullptr; }
+  bool empty() const { return this->len == 0; }
+  bool equals(const char *s) const {
+    return this->data != nullptr && strlen(s) == this->len && memcmp(this->data, s, this->len) == 0;
+  }
+  std::string str() const { return this->data != nullptr ? std::string(this->data, this->len) : std::string(); }
+};
+
+// The fields the message handlers act on, pulled out of an ElevenLabs control message.
+//
+// ElevenLabs nests each message's fields in an object named after its type --
+// {"type":"vad_score","vad_score_event":{"vad_score":0.03}} -- and no field name is
+// reused with a different meaning across types, so a flat struct can hold any of them.
+// The *_event flags record which of those objects was present.
+struct ControlMessage {
+  // The whole message, when it was read in place; empty after the ArduinoJson fallback.
+  JsonSpan raw;
+  JsonSpan type;
+
+  bool metadata_event{false};
+  JsonSpan conversation_id;
+  JsonSpan agent_output_audio_format;
+  JsonSpan user_input_audio_format;
+
+  bool audio_event{false};
+  JsonSpan audio_base_64;
+
+  bool transcript_event{false};
+  JsonSpan user_transcript;
+
+  bool response_event{false};
+  JsonSpan agent_response;
+
+  bool vad_event{false};
+  bool has_vad_score{false};
+  float vad_score{0.0f};
+
+  bool interruption_event{false};
+
+  bool ping_event{false};
+  uint32_t ping_ms{0};
+
+  bool tool_response_event{false};
+  JsonSpan tool_name;
+
+  bool has_event_id{false};
+  uint32_t event_id{0};
+};
+
+// Reads a control message straight out of the receive buffer.
+//
+// Every message used to go through JsonDeserializer::parse, which checks the heap twice,
+// allocates a document of at least 4KB, shrinks it and logs the deltas -- for messages
+// of a few dozen bytes arriving several times a second. This walks the JSON once, in
+// place and without allocating, validating its structure and recording the fields
+// above. The buffer is not modified and must outlive `out`.
+//
+// Returns false for anything it does not accept -- malformed JSON, or nesting deeper
+// than any ElevenLabs message uses -- and the caller then falls back to ArduinoJson.
+bool parse_control_message(const char *data, size_t len, ControlMessage &out);
+
+// Picks out the two messages that arrive most often -- vad_score, several times a
+// second, and ping, which wants its pong promptly -- by looking for their type and their
+// one field directly, without walking the rest. Short messages only, and no validation
+// beyond that: anything it does not recognise returns false and goes to
+// parse_control_message().
+bool scan_frequent_control_message(const char *data, size_t len, ControlMessage &out);
+
+// Fills `out` from a message ArduinoJson has already parsed, for the fallback path. The
+// spans point into the document, which must outlive `out`.
+void control_message_from_json(JsonObject root, ControlMessage &out);
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
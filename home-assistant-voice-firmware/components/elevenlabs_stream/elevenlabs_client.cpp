@@ -120,14 +120,35 @@ bool ElevenLabsClient::send_message(const std::string &message) {
   return websocket_->send_message(message);
 }
 
-bool ElevenLabsClient::send_binary(const uint8_t *data, size_t length) {
+bool ElevenLabsClient::send_message(const char *message, size_t length, TickType_t timeout) {
   if (!websocket_) return false;
-  return websocket_->send_binary(data, length);
+  return websocket_->send_message(message, length, timeout);
+}
+
+bool ElevenLabsClient::send_binary(const uint8_t *data, size_t length, TickType_t timeout) {
+  if (!websocket_) return false;
+  return websocket_->send_binary(data, length, timeout);
 }
 
 bool ElevenLabsClient::is_connected() const {
   return websocket_ && websocket_->is_connected();
 }
 
+void ElevenLabsClient::set_receive_slots(size_t count, size_t slot_size) {
+  if (websocket_) websocket_->set_receive_slots(count, slot_size);
+}
+
+void ElevenLabsClient::set_stream_handler(WebsocketStreamHandler* handler) {
+  if (websocket_) websocket_->set_stream_handler(handler);
+}
+
+void ElevenLabsClient::set_message_observer(std::function<void(const uint8_t*, size_t)> observer) {
+  if (websocket_) websocket_->set_message_observer(std::move(observer));
+}
+
+ReceiveStats ElevenLabsClient::get_receive_stats() const {
+  return websocket_ ? websocket_->get_receive_stats() : ReceiveStats{};
+}
+
 }  // namespace elevenlabs_stream
 }  // namespace esphome
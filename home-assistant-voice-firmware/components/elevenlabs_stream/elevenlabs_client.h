@@ -21,6 +21,12 @@ public:
   explicit ElevenLabsClient(const std::string& agent_id, const std::string& api_key = "");
   ~ElevenLabsClient();
 
+  // Number and size of the websocket receive slots; call before the first connect()
+  void set_receive_slots(size_t count, size_t slot_size);
+  // Offered each incoming message before it is assembled; see WebsocketStreamHandler
+  void set_stream_handler(WebsocketStreamHandler* handler);
+  void set_message_observer(std::function<void(const uint8_t*, size_t)> observer);
+
   // Gets a signed URL from ElevenLabs API
   bool get_signed_url(std::string& signed_url_out);
 
@@ -36,13 +42,17 @@ public:
 
   // Sends a text message over WebSocket
   bool send_message(const std::string& message);
+  bool send_message(const char* message, size_t length, TickType_t timeout = portMAX_DELAY);
 
   // Sends binary data over WebSocket
-  bool send_binary(const uint8_t* data, size_t length);
+  bool send_binary(const uint8_t* data, size_t length, TickType_t timeout = portMAX_DELAY);
 
   // Returns connection state
   bool is_connected() const;
 
+  // Fragment, message and slot counters for the receive path
+  ReceiveStats get_receive_stats() const;
+
 private:
   std::string agent_id_;
   std::string api_key_;
@@ -11,11 +11,14 @@
 
 #include "elevenlabs_stream.h"
 #include "json.h"
+#include "control_message.h"
 #include "base64.h"
+#include "pcm.h"
 #include "elevenlabs_client.h"
 
 #include <esp_task_wdt.h>
 #include <esp_heap_caps.h>
+#include <esp_timer.h>
 #include <freertos/FreeRTOS.h>  // pdMS_TO_TICKS for the blocking speaker write
 #include <inttypes.h>
 #include <cstring>  // memcmp, memchr for the audio fast path
@@ -27,9 +30,10 @@ using namespace esphome::json;
 
 static const char* TAG = "elevenlabs_stream";
 
-// How long a single blocking write waits for ring buffer space before returning 0.
-// Short enough to keep the websocket task responsive, long enough to avoid spinning.
-static const uint32_t SPEAKER_WRITE_WAIT_MS = 100;
+// How soon the playback task tries again when the speaker had no room, and how often
+// the consumer task looks for space in a full playback ring. The speaker holds far more
+// than this, so it never runs dry in between.
+static const TickType_t PLAYBACK_RETRY_TICKS = pdMS_TO_TICKS(10);
 
 // How long to keep retrying with NO progress at all before giving up on a chunk. The
 // speaker drains in real time, so any healthy buffer frees space well inside this;
@@ -45,28 +49,70 @@ static const uint32_t SPEAKER_START_TIMEOUT_MS = 500;
 static const uint32_t ACTIVATION_CHIME_TIMEOUT_MS = 2000;
 
 // Settle time after the chime reports finished, to let the shared i2s peripheral drain
-// before reply audio is queued behind it.
+// before reply audio is queued behind it. Only used as is when the activation speaker
+// has never reported its output; otherwise it bounds the wait for that report.
 static const uint32_t I2S_DRAIN_SETTLE_MS = 200;
 
-// How much decoded audio to hold before playback starts.
-//
-// Must exceed a single frame or it buys nothing. The first frame measured 18192 bytes,
-// so an earlier 16000-byte threshold was satisfied immediately, flushed on frame one,
-// and left no cushion at all -- the gap inside the opening word persisted unchanged.
+// How long after the last chime frame is played before the i2s output counts as drained.
+// Output is reported per DMA buffer, so this covers one more report that may be on its
+// way.
+static const uint32_t I2S_DRAIN_MARGIN_MS = 20;
+
+// How much decoded audio to hold before playback starts is up to the jitter estimator,
+// within the jitter_buffer bounds; see end_audio_frame().
 //
-// 48000 bytes is 1.5s at 16 kHz 16-bit mono and spans two to three frames, so playback
-// only begins once there is enough queued to ride out the wait for the next one.
-// ElevenLabs then streams faster than real time and the buffer stays ahead.
-static const uint32_t REPLY_PREBUFFER_BYTES = 48000;
+// It used to be a fixed 48000 bytes, released after at most 400ms. Holding a fixed
+// amount was right -- the first frame plays into a pipeline with nothing behind it
+// otherwise -- but the amount was not: on a good link the cushion only delayed the
+// reply, and on a poor one the 400ms cap released it before the cushion was there.
 
-// Hard ceiling on how long audio may sit in the prebuffer. Whatever is held is released
-// once this elapses, even if the size threshold was never met, so a short turn can never
-// be swallowed. Comfortably under the point where a listener notices a delayed reply.
-static const uint32_t REPLY_PREBUFFER_MAX_MS = 400;
+// The PCM ring the agent's audio is decoded into, playback_buffer_size in YAML. It has to
+// hold the whole prebuffer plus the frame that completes it, or prebuffering would end
+// early every time. The default, 128KB, is 4s at 16 kHz 16-bit mono.
 
 // How long to let a short reply finish playing before the speaker is stopped.
 static const uint32_t SPEAKER_DRAIN_TIMEOUT_MS = 3000;
 
+// Pooled JSON documents for the messages the control message reader declines. Parses
+// happen one at a time on the receive task, so the second is only headroom. Documents
+// are sized at twice the message, so 8KB serves messages up to 4KB; larger ones fall
+// back to a document of their own.
+static const size_t JSON_POOL_DOCUMENTS = 2;
+static const size_t JSON_POOL_DOCUMENT_BYTES = 8 * 1024;
+
+// Interruption messages are a few dozen bytes; anything longer is not looked at by
+// observe_message().
+static const size_t INTERRUPTION_SCAN_LIMIT = 256;
+
+// The microphone path captures 16 kHz mono; see uplink_codec.h for what is sent.
+static const size_t UPLINK_SAMPLES_PER_MS = 16;
+
+// Microphone audio waiting for the uplink task. 2s rides out a stalled send of up to
+// uplink_send_timeout with room to spare; beyond that the oldest audio is dropped. The
+// ring grows to hold connect_buffer if that is longer.
+static const size_t UPLINK_RING_SAMPLES = 2000 * UPLINK_SAMPLES_PER_MS;
+
+// Largest frame the uplink task sends when uplink_frame_duration is 0 and it is catching
+// up on a backlog: 64ms of audio.
+static const size_t UPLINK_MIN_FRAME_SAMPLES = 1024;
+
+// How soon the uplink task tries again after a failed send. Sleeping until the next
+// block instead could leave audio queued past the end of the conversation.
+static const TickType_t UPLINK_RETRY_TICKS = pdMS_TO_TICKS(20);
+
+// The keepalive frame sent while the uplink VAD holds the microphone back.
+static const int16_t UPLINK_SILENCE[UplinkVad::WINDOW_SAMPLES] = {};
+
+static const uint32_t UPLINK_TASK_STACK = 6144;
+static const UBaseType_t UPLINK_TASK_PRIORITY = 1;
+
+// Above the uplink: a late speaker write is audible, a late uplink frame is not.
+static const uint32_t PLAYBACK_TASK_STACK = 4096;
+static const UBaseType_t PLAYBACK_TASK_PRIORITY = 2;
+
+static const char PONG_PREFIX[] = "{\"type\":\"pong\",\"event_id\":";
+static const size_t PONG_PREFIX_LEN = sizeof(PONG_PREFIX) - 1;
+
 // vad_score above which an announcement treats the room as occupied and keeps waiting.
 // The service documents the score as the probability that the user is speaking, so this
 // is "more likely than not". See the VAD handler for why it sits above the LED's 0.25.
@@ -99,6 +145,7 @@ void ElevenLabsStream::handle_websocket_disconnected() {
   this->starting_ = false;
   this->end_call_requested_ = false;
   this->set_state(StreamState::OFF);
+  this->stop_capture();
   ESP_LOGD(TAG, "WS_EVENT: Triggering end events (%zu triggers)", this->on_end_triggers_.size());
   for (auto *trigger : this->on_end_triggers_) {
     ESP_LOGD(TAG, "WS_EVENT: Triggering end event at %p", trigger);
@@ -107,20 +154,42 @@ void ElevenLabsStream::handle_websocket_disconnected() {
   ESP_LOGD(TAG, "WS_EVENT: DISCONNECTED event handling complete");
 }
 
-bool ElevenLabsStream::decode_and_play_base64_audio(const char* base64_data) {
+// Decodes an assembled audio frame into the playback ring. Consumer task only: it may
+// wait for the playback task to make room.
+bool ElevenLabsStream::decode_assembled_audio_frame(const char* base64_data, size_t input_len) {
 
   if (!base64_data) {
     ESP_LOGW(TAG, "DECODE_B64: No base64 data provided");
     return false;
   }
-  size_t input_len = strlen(base64_data);
   if (input_len == 0) {
     ESP_LOGW(TAG, "DECODE_B64: Input base64 string is empty");
     return false;
   }
 
-  // Both audio paths -- the fast path and the JSON one -- come through here, so this is
-  // the one place that knows the agent has started talking. Until it does, an
+  if (this->interrupt_pending_.load()) {
+    ESP_LOGD(TAG, "DECODE_B64: Dropping a frame queued ahead of an interruption");
+    return true;
+  }
+  if (this->stopping_.load()) {
+    ESP_LOGD(TAG, "DECODE_B64: Dropping a frame that arrived while the stream is stopping");
+    return true;
+  }
+
+  this->begin_audio_frame();
+  if (!this->decode_into_sink(base64_data, input_len, true)) {
+    return false;
+  }
+  return this->end_audio_frame(input_len);
+}
+
+// Starts a frame of agent audio, whichever path it arrived by: assembled, or streamed
+// fragment by fragment through audio_scanner_.
+void ElevenLabsStream::begin_audio_frame() {
+  this->last_audio_time_ = millis();
+
+  // Every audio path -- streamed, the fast path and the JSON one -- comes through here,
+  // so this is the one place that knows the agent has started talking. Until it does, an
   // announcement's reply window must stay shut: connecting, fetching a signed URL and
   // synthesising the first message can easily outlast three seconds of "silence".
   this->agent_has_spoken_ = true;
@@ -138,34 +207,42 @@ bool ElevenLabsStream::decode_and_play_base64_audio(const char* base64_data) {
   //     announcement hung up around the time it started speaking instead of after
   //   - the LED's replying state, which never came on
   if (!this->speaker_is_active_) {
+    // The speaker has been idle, so this is the first frame of a new reply, and it
+    // gets a fresh cushion.
+    this->jitter_.begin_reply(millis());
+    this->reply_prebuffering_ = true;
     ESP_LOGI(TAG, "DECODE_B64: Setting speaker_is_active_ = true");
     this->speaker_is_active_ = true;
     for (auto *trigger : this->on_replying_triggers_) {
       trigger->trigger();
     }
+  } else if (!this->reply_prebuffering_ && this->playback_sink_.available() == 0 &&
+             this->reply_speaker_ != nullptr && !this->reply_speaker_->has_buffered_data()) {
+    // Mid-reply, and everything so far has already been played: the listener heard
+    // a gap while this frame was on its way.
+    this->jitter_.record_underrun();
+    ESP_LOGD(TAG, "DECODE_B64: Playback ran dry mid-reply; cushion is %" PRIu32 "ms", this->jitter_.target_ms());
   }
 
-  // Log PSRAM before decode
-  size_t psram_before_decode = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-  ESP_LOGD(TAG, "DECODE_B64: Starting decode, input_len=%zu, PSRAM Free=%zuKB", 
-           input_len, psram_before_decode / 1024);
-  
-  size_t decoded_len = 0;
-  uint8_t* decoded = base64_decode(base64_data, decoded_len);
-  if (!decoded || decoded_len == 0) {
-    ESP_LOGE(TAG, "DECODE_B64: Failed to decode base64 audio data (input len: %zu)", input_len);
-    return false;
+  // Decode straight into the playback ring. There is no intermediate buffer: the PCM
+  // is written where the speaker will read it, and held there while prebuffering.
+  if (this->reply_prebuffering_ && this->playback_sink_.available() == 0) {
+    this->reply_prebuffer_started_ms_ = millis();
   }
-  
-  // Log PSRAM after allocation
-  size_t psram_after_decode = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-  size_t psram_decode_delta = psram_before_decode - psram_after_decode;
-  ESP_LOGD(TAG, "DECODE_B64: Decoded %zu bytes of audio (PSRAM), PSRAM Free=%zuKB (-%zuKB)", 
-           decoded_len, psram_after_decode / 1024, psram_decode_delta / 1024);
-  
-  if (psram_after_decode < 1024 * 1024) {
-    ESP_LOGW(TAG, "DECODE_B64: LOW MEMORY WARNING: PSRAM Free=%zuKB", psram_after_decode / 1024);
+  this->audio_decoder_.reset();
+}
+
+// Ends a frame once all input_len characters have been fed to decode_into_sink(), and
+// releases the prebuffer or plays what was decoded.
+bool ElevenLabsStream::end_audio_frame(size_t input_len) {
+  if (!this->audio_decoder_.finish()) {
+    ESP_LOGE(TAG, "DECODE_B64: Base64 audio ended mid-quad (input len: %zu)", input_len);
+    return false;
   }
+  ESP_LOGD(TAG, "DECODE_B64: Decoded %zu chars into the playback ring, %zu/%zu bytes buffered", input_len,
+           this->playback_sink_.available(), this->playback_sink_.capacity());
+  const uint32_t bytes_per_ms = std::max<uint32_t>(this->agent_output_sample_rate_ * 2 / 1000, 1);
+  this->jitter_.add_frame(millis(), input_len / 4 * 3 / bytes_per_ms);
 
   // Build a cushion before playback starts.
   //
@@ -180,124 +257,403 @@ bool ElevenLabsStream::decode_and_play_base64_audio(const char* base64_data) {
   // immediately audible. Later audio never suffers because ElevenLabs sends faster
   // than real time and the buffer stays full.
   //
-  // So hold the first REPLY_PREBUFFER_BYTES back and release them together. Playback
-  // starts a fraction of a second later with a cushion already in hand.
+  // So hold the start of the reply back in the ring and release it together. Playback
+  // starts a fraction of a second later with a cushion already in hand, as large as
+  // the way earlier replies arrived says this one needs; see JitterEstimator.
   if (this->reply_prebuffering_) {
-    if (this->reply_prebuffer_.empty()) {
-      this->reply_prebuffer_started_ms_ = millis();
-    }
-    this->reply_prebuffer_.insert(this->reply_prebuffer_.end(), decoded, decoded + decoded_len);
-    heap_caps_free(decoded);
-
-    // Release on size OR on age, whichever comes first.
+    // Release once the cushion is held OR once it has been waited for, whichever comes
+    // first.
     //
     // Size alone is not safe: a turn whose audio totals less than the threshold would
     // be held and never played. That is not hypothetical -- a 48000-byte threshold did
     // exactly this, holding 31836 bytes to the end of the turn, and the device fell
     // silent for whole replies. The deadline guarantees audio always reaches the
     // speaker, so the threshold only decides how much cushion a big reply gets.
-    uint32_t held_ms = millis() - this->reply_prebuffer_started_ms_;
-    if (this->reply_prebuffer_.size() < REPLY_PREBUFFER_BYTES && held_ms < REPLY_PREBUFFER_MAX_MS) {
-      ESP_LOGD(TAG, "DECODE_B64: Prebuffering, %zu/%u bytes held for %ums", this->reply_prebuffer_.size(),
-               REPLY_PREBUFFER_BYTES, held_ms);
+    const uint32_t target_ms = this->jitter_.target_ms();
+    uint32_t waited_ms = millis() - this->reply_prebuffer_started_ms_;
+    uint32_t held_ms = this->playback_sink_.available() / bytes_per_ms;
+    if (held_ms < target_ms && waited_ms < target_ms) {
+      ESP_LOGD(TAG, "DECODE_B64: Prebuffering, %" PRIu32 "/%" PRIu32 "ms held after %" PRIu32 "ms", held_ms,
+               target_ms, waited_ms);
       return true;
     }
 
-    // Cushion reached: swap the accumulated audio in and fall through to write it.
-    ESP_LOGD(TAG, "DECODE_B64: Prebuffer full at %zu bytes; starting playback",
-             this->reply_prebuffer_.size());
+    ESP_LOGD(TAG, "DECODE_B64: Prebuffer of %" PRIu32 "ms ready after %" PRIu32 "ms; starting playback", held_ms,
+             waited_ms);
+    this->reply_start_delay_.record(waited_ms * 1000);
     this->reply_prebuffering_ = false;
-    decoded_len = this->reply_prebuffer_.size();
-    decoded = static_cast<uint8_t*>(heap_caps_malloc(decoded_len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
-    if (decoded == nullptr) {
-      decoded = static_cast<uint8_t*>(heap_caps_malloc(decoded_len, MALLOC_CAP_8BIT));
-    }
-    if (decoded == nullptr) {
-      ESP_LOGE(TAG, "DECODE_B64: Could not allocate %zu bytes to flush the prebuffer", decoded_len);
-      this->reply_prebuffer_.clear();
-      return false;
-    }
-    memcpy(decoded, this->reply_prebuffer_.data(), decoded_len);
-    this->reply_prebuffer_.clear();
-    this->reply_prebuffer_.shrink_to_fit();
   }
 
-  // Make sure the speaker is actually running before handing it the first chunk.
-  //
-  // Speaker::play() does start the speaker implicitly, but asynchronously, and the
-  // audio written during that transition is lost. The serial log shows the order
-  // plainly: "Audio fast path, payload=18192 bytes" and only then
-  // "resampler_speaker: Starting". Those 18192 bytes are ~0.57s at 16 kHz, which is
-  // why the reply consistently began mid-word -- "Naturally" arriving as "urally".
-  //
-  // Starting it explicitly and waiting for STATE_RUNNING costs a few milliseconds once
-  // per reply and keeps the opening syllable. The wait is bounded so a speaker that
-  // never comes up cannot wedge the websocket task.
-  if (!elevenlabs_speaker_->is_running()) {
-    ESP_LOGD(TAG, "DECODE_B64: Speaker not running; starting it before the first write");
-    elevenlabs_speaker_->start();
-    uint32_t start_deadline = millis() + SPEAKER_START_TIMEOUT_MS;
-    while (!elevenlabs_speaker_->is_running() && millis() < start_deadline) {
-      delay(2);
+  this->wake_playback();
+  return true;
+}
+
+// Whether a frame of `frame_len` bytes, 0 if not known yet, can be decoded on the
+// websocket task as it arrives.
+//
+// The websocket task must never wait for the speaker: while it does, no frame is read
+// and no pong goes out. So a frame is only streamed when the playback ring already has
+// room for all of it, which holds until it is decoded because nothing else writes to the
+// ring meanwhile. A frame that does not fit is assembled instead and decoded on the
+// consumer task, which can wait for room. That wait is what throttles ElevenLabs'
+// faster-than-real-time stream to the playback rate without dropping audio.
+bool ElevenLabsStream::sink_has_room_for_frame(size_t frame_len) const {
+  // The base64 payload is most of the frame, and decodes to three bytes per four.
+  return frame_len > 0 && this->playback_sink_.free_space() >= frame_len / 4 * 3;
+}
+
+// Decodes base64 audio into writable spans of the playback ring.
+//
+// The ring can only fill partway through an assembled frame: during prebuffering, or
+// when the speaker is behind. With `wait_for_room` the playback task is then given the
+// chance to free space, for up to SPEAKER_WRITE_STALL_TIMEOUT_MS without progress;
+// without it the rest of the frame is dropped. Only the consumer task may wait, and
+// not once stop_stream() has begun: it is waiting for this task to let go.
+bool ElevenLabsStream::decode_into_sink(const char* data, size_t len, bool wait_for_room) {
+  uint32_t last_progress = millis();
+  while (len > 0) {
+    if (this->stopping_.load()) {
+      return false;
     }
-    if (!elevenlabs_speaker_->is_running()) {
-      ESP_LOGW(TAG, "DECODE_B64: Speaker did not reach running state within %ums; writing anyway",
-               SPEAKER_START_TIMEOUT_MS);
+    size_t span_len = 0;
+    uint8_t* span = this->playback_sink_.acquire(span_len);
+
+    // A quad decodes to three bytes. When the span left before the ring wraps is
+    // shorter than that, decode into a bounce buffer and let write() split it.
+    uint8_t bounce[3];
+    bool bounced = false;
+    if (span_len < sizeof(bounce) && this->playback_sink_.free_space() >= sizeof(bounce)) {
+      span = bounce;
+      span_len = sizeof(bounce);
+      bounced = true;
     }
-  }
 
-  // Speaker::play() is NON-BLOCKING: it copies only what currently fits in the ring
-  // buffer and returns how much it took. ElevenLabs streams audio faster than it plays
-  // back, so the buffer fills routinely and short writes are normal, not exceptional.
-  //
-  // This used to write once, free the buffer, and return false on a short write --
-  // silently discarding the remainder. That is audible as whole clauses vanishing
-  // mid-sentence while the rest plays cleanly, which is exactly what a room recording
-  // of a reply showed: about three quarters of it never reached the speaker.
-  //
-  // Retry the remainder with the blocking overload instead, so the socket is throttled
-  // by playback rather than audio being dropped. The stall timer only advances while no
-  // progress is made, so a slow-but-moving speaker is never treated as stuck.
-  size_t total_written = 0;
-  uint32_t last_progress = millis();
-  bool stalled = false;
-
-  while (total_written < decoded_len) {
-    size_t written = elevenlabs_speaker_->play(decoded + total_written, decoded_len - total_written,
-                                               pdMS_TO_TICKS(SPEAKER_WRITE_WAIT_MS));
-    if (written > 0) {
-      total_written += written;
-      last_progress = millis();
+    if (span_len < sizeof(bounce)) {
+      if (!wait_for_room) {
+        ESP_LOGW(TAG, "DECODE_B64: Playback ring full mid-stream, dropping %zu chars of the frame", len);
+        return false;
+      }
+      if (this->interrupt_pending_.load()) {
+        // The rest of this frame is about to be flushed anyway.
+        return false;
+      }
+      if (this->reply_prebuffering_) {
+        // A full ring is as much cushion as there is going to be.
+        ESP_LOGD(TAG, "DECODE_B64: Playback ring full at %zu bytes while prebuffering; starting playback",
+                 this->playback_sink_.available());
+        this->reply_prebuffering_ = false;
+      }
+      this->wake_playback();
+      vTaskDelay(PLAYBACK_RETRY_TICKS);
+      if (this->playback_sink_.free_space() > 0) {
+        last_progress = millis();
+      } else if (millis() - last_progress >= SPEAKER_WRITE_STALL_TIMEOUT_MS) {
+        ESP_LOGE(TAG, "DECODE_B64: Speaker stalled for %ums with the playback ring full, dropping the rest of the frame",
+                 SPEAKER_WRITE_STALL_TIMEOUT_MS);
+        return false;
+      }
       continue;
     }
 
-    if (millis() - last_progress >= SPEAKER_WRITE_STALL_TIMEOUT_MS) {
-      // Give up rather than block the websocket task forever; losing the tail of one
-      // chunk beats wedging the connection.
-      ESP_LOGE(TAG, "DECODE_B64: Speaker stalled for %ums, dropping %zu of %zu bytes",
-               SPEAKER_WRITE_STALL_TIMEOUT_MS, decoded_len - total_written, decoded_len);
-      stalled = true;
-      break;
+    size_t consumed = 0;
+    size_t written = 0;
+    if (!this->audio_decoder_.feed_into(data, len, span, span_len, consumed, written)) {
+      ESP_LOGE(TAG, "DECODE_B64: Failed to decode base64 audio data (%zu chars left)", len);
+      this->audio_decoder_.reset();
+      return false;
     }
+    if (bounced) {
+      this->playback_sink_.write(bounce, written);
+    } else {
+      this->playback_sink_.commit(written);
+    }
+    data += consumed;
+    len -= consumed;
+    last_progress = millis();
   }
+  return true;
+}
+
+// Make sure the speaker is actually running before handing it the first chunk.
+//
+// Speaker::play() does start the speaker implicitly, but asynchronously, and the
+// audio written during that transition is lost. The serial log shows the order
+// plainly: "Audio fast path, payload=18192 bytes" and only then
+// "resampler_speaker: Starting". Those 18192 bytes are ~0.57s at 16 kHz, which is
+// why the reply consistently began mid-word -- "Naturally" arriving as "urally".
+//
+// Starting it explicitly and waiting for STATE_RUNNING costs a few milliseconds once
+// per reply and keeps the opening syllable. Returns false while the speaker is still
+// starting, and the playback task sleeps between checks rather than spinning. The wait
+// is bounded so a speaker that never comes up cannot wedge the playback task.
+bool ElevenLabsStream::ensure_speaker_running() {
+  if (this->reply_speaker_->is_running()) {
+    this->speaker_starting_since_ms_ = 0;
+    return true;
+  }
+  const uint32_t now = millis();
+  if (this->speaker_starting_since_ms_ == 0) {
+    ESP_LOGD(TAG, "PLAYBACK: Speaker not running; starting it before the first write");
+    this->reply_speaker_->start();
+    this->speaker_starting_since_ms_ = std::max<uint32_t>(now, 1);
+    this->speaker_start_timed_out_ = false;
+    return false;
+  }
+  if (now - this->speaker_starting_since_ms_ < SPEAKER_START_TIMEOUT_MS) {
+    return false;
+  }
+  if (!this->speaker_start_timed_out_) {
+    ESP_LOGW(TAG, "PLAYBACK: Speaker did not reach running state within %ums; writing anyway",
+             SPEAKER_START_TIMEOUT_MS);
+    this->speaker_start_timed_out_ = true;
+  }
+  return true;
+}
 
-  ESP_LOGD(TAG, "DECODE_B64: Played %zu bytes from decoded buffer (expected %zu)", total_written, decoded_len);
+// Brings the reply speaker up for a new conversation.
+//
+// Started by the agent's metadata. Until it is done the playback task holds back, but
+// nothing else waits: frames keep arriving and are decoded into the playback ring,
+// which is where the first reply builds its cushion meanwhile.
+//
+//   CHIME    the activation chime, which shares the i2s output with the reply, has
+//            finished playing into its resampler
+//   DRAIN    the i2s output has played the chime's last frame
+//   SPEAKER  the reply speaker is configured for the agent's format and running
+//
+// Each phase ends on an event rather than on loop() asking the speakers where they are:
+// the activation speaker reporting output, the playback task reporting the reply
+// speaker running. ESPHome speakers report no state changes, so the chime counts as
+// finished once an output report finds nothing left buffered behind it. loop() only
+// ends a phase whose event is late; see check_start_sequence_deadline().
+void ElevenLabsStream::request_start_sequence() {
+  LockGuard guard(this->start_lock_);
+  const uint32_t now = millis();
+  if (!this->activation_speaker_audio_stream_infoset_ && this->activation_speaker_ != nullptr) {
+    this->activation_speaker_audio_stream_info = this->activation_speaker_->get_audio_stream_info();
+    this->activation_speaker_audio_stream_infoset_ = true;
+    ESP_LOGI(TAG, "START_SEQ: Initial audio stream info set: %d Hz, %d channels, %d bits per sample",
+             this->activation_speaker_audio_stream_info.get_sample_rate(),
+             this->activation_speaker_audio_stream_info.get_channels(),
+             this->activation_speaker_audio_stream_info.get_bits_per_sample());
+  }
+  this->start_sequence_began_ms_ = now;
+  this->enter_start_phase(StartPhase::CHIME, now);
+  this->advance_start_sequence(StartEvent::ENTERED, now);
+}
 
-  if (decoded) {
-    heap_caps_free(decoded);
+void ElevenLabsStream::notify_start_sequence(StartEvent event) {
+  LockGuard guard(this->start_lock_);
+  this->advance_start_sequence(event, millis());
+}
 
-    // Log PSRAM after freeing
-    size_t psram_after_free = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    int64_t psram_freed = (int64_t)psram_after_free - (int64_t)psram_after_decode;
-    ESP_LOGD(TAG, "DECODE_B64: Buffer freed, PSRAM Free=%zuKB (%+" PRId64 "KB)",
-             psram_after_free / 1024, psram_freed / 1024);
+// The only part of the start sequence left to loop(): a phase whose event has not come
+// by its deadline ends anyway.
+void ElevenLabsStream::check_start_sequence_deadline() {
+  LockGuard guard(this->start_lock_);
+  const uint32_t now = millis();
+  if (this->start_phase_ != StartPhase::IDLE && this->start_phase_ != StartPhase::READY &&
+      static_cast<int32_t>(now - this->start_phase_deadline_ms_) >= 0) {
+    this->advance_start_sequence(StartEvent::DEADLINE, now);
   }
+}
 
-  if (stalled) {
-    return false;
+// Moves through as many phases as `event` completes. Called with start_lock_ held, from
+// whichever task the event arrived on.
+void ElevenLabsStream::advance_start_sequence(StartEvent event, uint32_t now) {
+  switch (this->start_phase_) {
+    case StartPhase::CHIME:
+      // Let the activation chime finish before any reply audio is queued.
+      //
+      // The chime plays on activation_speaker while the reply plays on
+      // elevenlabs_speaker, and both feed the same i2s output. Overlapping them
+      // costs the first moment of speech: observed as a gap between "Naturally" and
+      // "sir", or a doubled opening syllable, always inside the first second and
+      // roughly one run in five.
+      if (event != StartEvent::DEADLINE && this->activation_speaker_ != nullptr) {
+        bool finished = event == StartEvent::CHIME_OUTPUT ? !this->activation_speaker_->has_buffered_data()
+                                                          : !this->activation_speaker_->is_running() &&
+                                                                !this->activation_speaker_->has_buffered_data();
+        if (!finished) {
+          this->start_phase_deadline_ms_ = this->start_phase_began_ms_ + ACTIVATION_CHIME_TIMEOUT_MS;
+          return;
+        }
+      }
+      this->start_stats_.chime_ms = now - this->start_phase_began_ms_;
+      this->enter_start_phase(StartPhase::DRAIN, now);
+      event = StartEvent::ENTERED;
+      // fall through
+    case StartPhase::DRAIN: {
+      // Then let the i2s peripheral actually drain.
+      //
+      // The chime phase asks the RESAMPLER whether it is done, but both speakers feed
+      // one shared i2s_audio_speaker, and i2s keeps emitting for a short while after
+      // the resampler reports empty. Reply audio starting inside that window collides
+      // with the chime tail, which is heard as a gap partway through the first word.
+      //
+      // The activation speaker reports when each stretch of output is played, and the
+      // output has drained once the last of it is past. That used to be a fixed 200ms
+      // on every reply, for want of something to poll; it still is, for a speaker that
+      // never reports, and it bounds the wait for one that does. A later report moves
+      // the end of the phase with it.
+      uint32_t waited = now - this->start_phase_began_ms_;
+      this->start_stats_.drain_signalled = this->chime_output_seen_.load();
+      if (event != StartEvent::DEADLINE) {
+        uint32_t deadline = this->start_phase_began_ms_ + I2S_DRAIN_SETTLE_MS;
+        if (this->start_stats_.drain_signalled) {
+          uint32_t now_played_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+          int32_t until_drained =
+              static_cast<int32_t>(this->chime_output_ms_.load() + I2S_DRAIN_MARGIN_MS - now_played_ms);
+          if (until_drained <= 0) {
+            deadline = now;
+          } else if (static_cast<int32_t>(now + until_drained - deadline) < 0) {
+            deadline = now + until_drained;
+          }
+        }
+        if (static_cast<int32_t>(deadline - now) > 0) {
+          this->start_phase_deadline_ms_ = deadline;
+          return;
+        }
+      }
+      this->start_stats_.drain_ms = waited;
+      this->enter_start_phase(StartPhase::SPEAKER, now);
+      event = StartEvent::ENTERED;
+      // The playback task configures and starts the speaker; see service_playback().
+      if (this->elevenlabs_speaker_ != nullptr) {
+        this->speaker_start_requested_.store(true);
+        this->wake_playback();
+      }
+    }
+      // fall through
+    case StartPhase::SPEAKER:
+      // Bring the speaker up before any audio reaches it. Writing while it is still
+      // starting loses the opening syllable ("Naturally" as "urally"); by the time
+      // the playback task is let go, the speaker is running.
+      if (event != StartEvent::DEADLINE && this->elevenlabs_speaker_ != nullptr && !this->speaker_started_.load()) {
+        this->start_phase_deadline_ms_ = this->start_phase_began_ms_ + SPEAKER_START_TIMEOUT_MS;
+        return;
+      }
+      this->start_stats_.speaker_ms = now - this->start_phase_began_ms_;
+      this->enter_start_phase(StartPhase::READY, now);
+      this->playback_ready_.store(true);
+      this->wake_playback();
+      ESP_LOGD(TAG, "START_SEQ: Speaker ready after %" PRIu32 "ms: chime %" PRIu32 "ms, drain %" PRIu32
+               "ms (%s), speaker %" PRIu32 "ms",
+               now - this->start_sequence_began_ms_, this->start_stats_.chime_ms, this->start_stats_.drain_ms,
+               this->start_stats_.drain_signalled ? "signalled" : "fixed", this->start_stats_.speaker_ms);
+      return;
+    case StartPhase::IDLE:
+    case StartPhase::READY:
+    default:
+      return;
   }
+}
 
-  return true;
+void ElevenLabsStream::enter_start_phase(StartPhase phase, uint32_t now) {
+  this->start_phase_ = phase;
+  this->start_phase_began_ms_ = now;
+}
+
+void ElevenLabsStream::wake_playback() {
+  if (this->playback_task_ != nullptr) {
+    xTaskNotifyGive(this->playback_task_);
+  }
+}
+
+void ElevenLabsStream::playback_task(void* arg) {
+  ElevenLabsStream* self = static_cast<ElevenLabsStream*>(arg);
+  TickType_t wait = portMAX_DELAY;
+  while (true) {
+    // Woken by every frame the receive side releases; the timeout is the retry while
+    // the speaker has no room.
+    ulTaskNotifyTake(pdTRUE, wait);
+    wait = self->service_playback();
+  }
+}
+
+// Feeds the playback ring to the speaker. Runs on the playback task only, and returns
+// how long it may sleep.
+//
+// This used to happen on the receive task, which looped on a blocking play() for up to
+// five seconds per frame and busy-waited for the speaker to start. For all that time no
+// websocket frame was read and no pong went out, so TCP's window closed behind it and
+// the agent's audio arrived in bursts after each stall. The receive side now only
+// decodes into the ring; the network and the speaker each run at their own rate.
+//
+// Speaker::play() is NON-BLOCKING here: it copies only what currently fits and returns
+// how much it took. ElevenLabs streams faster than real time, so the speaker fills
+// routinely and short writes are normal, not exceptional -- what does not fit stays in
+// the ring and is retried shortly. Dropping it instead is audible as whole clauses
+// vanishing mid-sentence. The stall timer only advances while no progress is made, so
+// a slow-but-moving speaker is never treated as stuck.
+TickType_t ElevenLabsStream::service_playback() {
+  if (this->speaker_flush_requested_.exchange(false)) {
+    // A start still pending belongs to the conversation being flushed; a request for
+    // the next one is taken below, after the stop.
+    this->speaker_start_pending_ = false;
+    // Not is_running(): a speaker still starting would come up with the old audio.
+    if (this->reply_speaker_ != nullptr && !this->reply_speaker_->is_stopped()) {
+      // stop() discards what the speaker has queued; ensure_speaker_running() brings it
+      // back for the next response.
+      ESP_LOGD(TAG, "PLAYBACK: Stopping the speaker to drop the flushed reply");
+      this->reply_speaker_->stop();
+    }
+    this->speaker_starting_since_ms_ = 0;
+    this->playback_stalled_since_ms_ = 0;
+  }
+  if (this->speaker_start_requested_.exchange(false)) {
+    // Reapply the stream info every conversation, not just the first: a stopped speaker
+    // does not necessarily retain the input rate configured for it. This also picks the
+    // speaker for the agent's rate. Nothing is being played meanwhile; the start
+    // sequence holds playback back until it is done.
+    this->set_speaker_stream_info_to_elevenlabs_format();
+    this->speaker_start_pending_ = true;
+  }
+  if (this->speaker_start_pending_) {
+    if (!this->ensure_speaker_running()) {
+      return PLAYBACK_RETRY_TICKS;
+    }
+    this->speaker_start_pending_ = false;
+    this->speaker_started_.store(true);
+    this->notify_start_sequence(StartEvent::SPEAKER_STARTED);
+  }
+  // After an interruption nothing more of the reply is fed; the consumer task is about
+  // to flush it and will wake the task again.
+  if (!this->playback_ready_.load() || this->interrupt_pending_.load() || this->reply_prebuffering_ ||
+      this->playback_sink_.available() == 0) {
+    this->playback_stalled_since_ms_ = 0;
+    return portMAX_DELAY;
+  }
+  if (!this->ensure_speaker_running()) {
+    return PLAYBACK_RETRY_TICKS;
+  }
+
+  const uint32_t started_us = micros();
+  size_t written = 0;
+  size_t chunk;
+  while ((chunk = this->playback_sink_.pump(0)) > 0) {
+    written += chunk;
+  }
+  this->playback_busy_us_ += micros() - started_us;
+  this->playback_bytes_ += written;
+
+  if (this->playback_sink_.available() == 0) {
+    this->playback_stalled_since_ms_ = 0;
+    return portMAX_DELAY;
+  }
+  uint32_t now = millis();
+  if (written > 0 || this->playback_stalled_since_ms_ == 0) {
+    this->playback_stalled_since_ms_ = now;
+  } else if (now - this->playback_stalled_since_ms_ >= SPEAKER_WRITE_STALL_TIMEOUT_MS) {
+    // Give up on what is queued rather than hold it forever; the receive side would
+    // otherwise stall behind a full ring as well.
+    ESP_LOGE(TAG, "PLAYBACK: Speaker stalled for %ums, dropping %zu bytes", SPEAKER_WRITE_STALL_TIMEOUT_MS,
+             this->playback_sink_.available());
+    this->playback_sink_.clear();
+    this->playback_stalled_since_ms_ = 0;
+    return portMAX_DELAY;
+  }
+  return PLAYBACK_RETRY_TICKS;
 }
 
 // Sets the speaker's audio stream info based on the agent output format, if available.
@@ -311,8 +667,32 @@ void ElevenLabsStream::set_speaker_stream_info_to_elevenlabs_format() {
   else if (this->agent_output_audio_format_ == "pcm_44100") sample_rate = 44100;
   else if (this->agent_output_audio_format_ == "pcm_48000") sample_rate = 48000;
 
+  this->agent_output_sample_rate_ = sample_rate;
+  this->select_reply_speaker();
   esphome::audio::AudioStreamInfo info(16, 1, sample_rate);
-  elevenlabs_speaker_->set_audio_stream_info(info);
+  this->reply_speaker_->set_audio_stream_info(info);
+}
+
+// Picks the speaker this conversation's replies are played on, once the agent's format is
+// known. Runs on the playback task, while the start sequence still holds playback back.
+//
+// elevenlabs_speaker is normally a resampler in front of the i2s output. When the agent
+// already sends PCM at the output rate, the resampler has nothing to convert, and the
+// passthrough speaker takes the decoded audio directly instead. What that saves has not
+// been measured on the device; stop_stream() logs the cost of whichever path was taken.
+void ElevenLabsStream::select_reply_speaker() {
+  speaker::Speaker *speaker = this->elevenlabs_speaker_;
+  if (this->passthrough_speaker_ != nullptr && this->agent_output_sample_rate_ == this->passthrough_sample_rate_) {
+    speaker = this->passthrough_speaker_;
+  }
+  if (speaker != this->reply_speaker_) {
+    ESP_LOGI(TAG, "START_SEQ: Playing replies %s at %" PRIu32 " Hz",
+             speaker == this->passthrough_speaker_ ? "straight to the output, bypassing the resampler"
+                                                   : "through the resampler",
+             this->agent_output_sample_rate_);
+    this->reply_speaker_ = speaker;
+    this->playback_sink_.set_speaker(speaker);
+  }
 }
 
 void ElevenLabsStream::setup() {
@@ -338,9 +718,97 @@ void ElevenLabsStream::setup() {
 
   if (!this->client_) {
     this->client_ = new ElevenLabsClient(this->agent_id_, this->api_key_);
+    this->client_->set_receive_slots(this->receive_slots_, this->receive_slot_size_);
+    this->client_->set_stream_handler(&this->audio_scanner_);
+    if (this->barge_in_) {
+      this->client_->set_message_observer([this](const uint8_t* data, size_t len) { this->observe_message(data, len); });
+    }
+  }
+
+  // Allocated once for the life of the device, so no reply ever waits on an allocation.
+  this->reply_speaker_ = this->elevenlabs_speaker_;
+  this->playback_sink_.set_speaker(this->elevenlabs_speaker_);
+  if (!this->playback_sink_.allocate(this->playback_buffer_size_)) {
+    ESP_LOGE(TAG, "SETUP: Could not allocate the %zu byte playback ring - SETUP FAILED", this->playback_buffer_size_);
+    this->mark_failed();
+    return;
+  }
+
+  if (this->playback_task_ == nullptr &&
+      xTaskCreate(&ElevenLabsStream::playback_task, "el_playback", PLAYBACK_TASK_STACK, this, PLAYBACK_TASK_PRIORITY,
+                  &this->playback_task_) != pdPASS) {
+    ESP_LOGE(TAG, "SETUP: Could not start the playback task - SETUP FAILED");
+    this->playback_task_ = nullptr;
+    this->mark_failed();
+    return;
+  }
+
+  memcpy(this->pong_message_, PONG_PREFIX, PONG_PREFIX_LEN);
+
+  // The microphone task only converts and queues; the uplink task encodes and sends.
+  if (!this->uplink_ring_.allocate(
+          std::max<size_t>(UPLINK_RING_SAMPLES, this->connect_buffer_ms_ * UPLINK_SAMPLES_PER_MS))) {
+    ESP_LOGE(TAG, "SETUP: Could not allocate the uplink ring - SETUP FAILED");
+    this->mark_failed();
+    return;
+  }
+  size_t frame_samples = std::max<size_t>(this->uplink_frame_duration_ms_ * UPLINK_SAMPLES_PER_MS,
+                                          UPLINK_MIN_FRAME_SAMPLES);
+  this->audio_buffer_.resize(frame_samples);
+  this->uplink_frame_.reserve(frame_samples * sizeof(int16_t));
+  if (this->uplink_format_ == UplinkFormat::ULAW_8000) {
+    this->uplink_encoded_.resize((frame_samples + 1) / 2);
+  }
+  if (this->uplink_vad_enabled_) {
+    this->uplink_pre_roll_.resize(this->uplink_pre_roll_ms_ / 20 * UplinkVad::WINDOW_SAMPLES);
+    ESP_LOGCONFIG(TAG, "SETUP: Uplink VAD at %.1f dBFS, %" PRIu32 "ms pre-roll, keepalive every %" PRIu32 "ms",
+                  this->uplink_vad_threshold_db_, this->uplink_pre_roll_ms_, this->uplink_keepalive_ms_);
+  }
+  if (this->uplink_task_ == nullptr &&
+      xTaskCreate(&ElevenLabsStream::uplink_task, "el_uplink", UPLINK_TASK_STACK, this, UPLINK_TASK_PRIORITY,
+                  &this->uplink_task_) != pdPASS) {
+    ESP_LOGE(TAG, "SETUP: Could not start the uplink task - SETUP FAILED");
+    this->uplink_task_ = nullptr;
+    this->mark_failed();
+    return;
   }
 
-  elevenlabs_speaker_->add_audio_output_callback([this](uint32_t _a, int64_t _b) {
+  // Not fatal: without the pool, the JSON fallback allocates per message as it used to.
+  if (!this->json_pool_.allocate(JSON_POOL_DOCUMENTS, JSON_POOL_DOCUMENT_BYTES)) {
+    ESP_LOGW(TAG, "SETUP: JSON document pool only partly allocated");
+  }
+
+  // Audio frames are decoded fragment by fragment as they arrive, on the websocket task,
+  // when the playback ring can take the whole frame; see sink_has_room_for_frame().
+  this->audio_scanner_.set_on_begin([this](size_t frame_len) {
+    if (this->stopping_.load() || !this->sink_has_room_for_frame(frame_len)) {
+      return false;
+    }
+    this->begin_audio_frame();
+    return true;
+  });
+  this->audio_scanner_.set_on_payload(
+      [this](const char* data, size_t len) { return this->decode_into_sink(data, len, false); });
+  this->audio_scanner_.set_on_end([this](size_t payload_len, bool complete) {
+    if (!complete) {
+      ESP_LOGW(TAG, "DECODE_B64: Streamed audio frame ended early after %zu chars", payload_len);
+      this->audio_decoder_.reset();
+      return;
+    }
+    this->end_audio_frame(payload_len);
+  });
+
+  // The chime and i2s drain signal for the start sequence: when the chime's last frame
+  // left the output.
+  if (this->activation_speaker_ != nullptr) {
+    this->activation_speaker_->add_audio_output_callback([this](uint32_t frames, int64_t played_us) {
+      this->chime_output_ms_.store(static_cast<uint32_t>(played_us / 1000));
+      this->chime_output_seen_.store(true);
+      this->notify_start_sequence(StartEvent::CHIME_OUTPUT);
+    });
+  }
+
+  auto on_reply_output = [this](uint32_t _a, int64_t _b) {
     this->cancel_timeout("audio_output_callback");
     this->set_timeout("audio_output_callback", 250, [this]() {
       if(!this->speaker_is_active_) {
@@ -359,7 +827,17 @@ void ElevenLabsStream::setup() {
       }
     });
 
-  });
+  };
+  elevenlabs_speaker_->add_audio_output_callback(on_reply_output);
+  if (this->passthrough_speaker_ != nullptr) {
+    // The output speaker reports the chime's frames too, so it only counts while replies
+    // are being played straight to it.
+    this->passthrough_speaker_->add_audio_output_callback([this, on_reply_output](uint32_t frames, int64_t played_us) {
+      if (this->reply_speaker_ == this->passthrough_speaker_) {
+        on_reply_output(frames, played_us);
+      }
+    });
+  }
   
   ESP_LOGD(TAG, "SETUP: Initial state set to %d (IDLE)", static_cast<int>(this->state_));
   ESP_LOGCONFIG(TAG, "=== SETUP COMPLETE ===");
@@ -382,20 +860,25 @@ void ElevenLabsStream::loop() {
   static uint32_t loop_count = 0;
   loop_count++;
 
-  if(this->speaker_is_active_) {
+  this->check_start_sequence_deadline();
+
+  // Not while the start sequence is still running: it decides when the speakers start.
+  // The reply speaker is the playback task's to start; see ensure_speaker_running().
+  if (this->speaker_is_active_ && this->playback_ready_.load()) {
     if (!this->activation_speaker_->is_running()) {
       ESP_LOGD(TAG, "LOOP: Activation speaker not running, starting it now");
       this->activation_speaker_->start();
       return;
     }
-
-    if (!this->elevenlabs_speaker_->is_running()) {
-      ESP_LOGD(TAG, "LOOP: ElevenLabs speaker not running, starting it now");
-      this->elevenlabs_speaker_->start();
-      return;
-    }
   }
   
+  // The agent's metadata has arrived on the websocket's consumer task: the conversation
+  // is ready, so the connect buffer need not wait out the rest of the grace period.
+  if (this->conversation_ready_.exchange(false) && this->starting_ && this->connect_buffer_ms_ > 0) {
+    this->cancel_timeout("enable_microphone");
+    this->begin_conversation();
+  }
+
   if (millis() - last_watchdog_feed > 1000) { // Feed every second
     esp_task_wdt_reset();
     last_watchdog_feed = millis();
@@ -415,6 +898,66 @@ void ElevenLabsStream::loop() {
     if (psram_free < 1024 * 1024) {
       ESP_LOGW(TAG, "LOOP: LOW MEMORY WARNING: PSRAM Free=%zuKB", psram_free / 1024);
     }
+
+    if (this->client_ && this->state_ == StreamState::ON) {
+      ReceiveStats rx = this->client_->get_receive_stats();
+      ESP_LOGD(TAG, "LOOP: Receive: %" PRIu32 " fragments, %" PRIu32 " messages, %" PRIu32 " out of order, %" PRIu32
+               " dropped, %" PRIu32 " slot waits, %" PRIu32 " slot overruns, %" PRIu32 " streamed",
+               rx.fragments, rx.messages, rx.out_of_order, rx.dropped, rx.slot_waits, rx.slot_overruns, rx.streamed);
+      // Per-second uplink rates over the interval since the last report.
+      uint32_t interval_ms = millis() - last_psram_log;
+      uint32_t frames = this->uplink_frames_.load();
+      uint32_t bytes = this->uplink_bytes_.load();
+      uint32_t microphone_busy_us = this->microphone_busy_us_.load();
+      uint32_t busy_us = this->uplink_busy_us_.load();
+      uint32_t send_us = this->uplink_send_us_.load();
+      if (interval_ms > 0) {
+        auto per_second = [interval_ms](uint32_t delta) { return (uint32_t) ((uint64_t) delta * 1000 / interval_ms); };
+        ESP_LOGD(TAG, "LOOP: Uplink: %" PRIu32 " frames/s, %" PRIu32 " bytes/s, %" PRIu32
+                 " us/s on the microphone task, %" PRIu32 " us/s on the uplink task (%" PRIu32 " of them sending)",
+                 (frames - this->uplink_report_.frames) * 1000 / interval_ms,
+                 per_second(bytes - this->uplink_report_.bytes),
+                 per_second(microphone_busy_us - this->uplink_report_.microphone_busy_us),
+                 per_second(busy_us - this->uplink_report_.busy_us), per_second(send_us - this->uplink_report_.send_us));
+      }
+      this->uplink_report_ = {frames, bytes, microphone_busy_us, busy_us, send_us};
+      UplinkMetrics uplink = this->get_uplink_metrics();
+      ESP_LOGD(TAG, "LOOP: Uplink queue: %" PRIu32 " bytes (high %" PRIu32 "), %" PRIu32 " dropped, %" PRIu32
+               " timeouts, %" PRIu32 " failures, %" PRIu32 " control failures",
+               uplink.queued_bytes, uplink.queued_high_water_bytes, uplink.dropped_bytes, uplink.send_timeouts,
+               uplink.send_failures, uplink.control_send_failures);
+      ESP_LOGD(TAG, "LOOP: Uplink send latency over %" PRIu32 " sends: p50 %" PRIu32 "us, p90 %" PRIu32
+               "us, p99 %" PRIu32 "us", uplink.sends, uplink.send_p50_us, uplink.send_p90_us, uplink.send_p99_us);
+      // High water and latency cover one report interval each.
+      this->uplink_ring_.reset_high_water();
+      this->uplink_send_latency_.reset();
+      if (this->uplink_vad_enabled_) {
+        UplinkVadStats vad = this->get_uplink_vad_stats();
+        ESP_LOGD(TAG, "LOOP: Uplink VAD: %" PRIu32 " bytes sent, %" PRIu32 " suppressed, %" PRIu32
+                 " keepalives, %" PRIu32 " speech segments this conversation",
+                 vad.sent_bytes, vad.suppressed_bytes, vad.keepalive_frames, vad.speech_segments);
+      }
+      JitterEstimator::Stats jitter = this->jitter_.get_stats();
+      ESP_LOGD(TAG, "LOOP: Jitter buffer: %" PRIu32 "ms cushion, %" PRIu32 "ms jitter, last reply %" PRIu32
+               "ms late at worst and %" PRIu32 "%% of real time, %" PRIu32 " underruns in %" PRIu32 " replies",
+               jitter.target_ms, jitter.jitter_ms, jitter.last_lag_ms, jitter.realtime_percent, jitter.underruns,
+               jitter.replies);
+      ESP_LOGD(TAG, "LOOP: Reply start delay this conversation: p50 %" PRIu32 "ms, p90 %" PRIu32 "ms",
+               this->reply_start_delay_.percentile(50) / 1000, this->reply_start_delay_.percentile(90) / 1000);
+      PlaybackMetrics playback = this->get_playback_metrics();
+      ESP_LOGD(TAG, "LOOP: Playback ring: %zu of %zu bytes buffered, high %zu", playback.buffered_bytes,
+               playback.capacity_bytes, playback.high_water_bytes);
+      if (interval_ms > 0) {
+        ESP_LOGD(TAG, "LOOP: Playback: %" PRIu32 " bytes/s to the speaker, %" PRIu32 " us/s on the playback task",
+                 (uint32_t) ((uint64_t) (playback.played_bytes - this->playback_report_.bytes) * 1000 / interval_ms),
+                 (uint32_t) ((uint64_t) (playback.busy_us - this->playback_report_.busy_us) * 1000 / interval_ms));
+      }
+      this->playback_report_ = {playback.played_bytes, playback.busy_us};
+      this->playback_sink_.reset_high_water();
+      const JsonDocumentPool::Stats pool = this->json_pool_.get_stats();
+      ESP_LOGD(TAG, "LOOP: JSON pool: %" PRIu32 " hits, %" PRIu32 " misses, %" PRIu32 " fallbacks, %" PRIu32
+               " overflows", pool.hits, pool.misses, pool.fallbacks, pool.overflows);
+    }
     
     last_psram_log = millis();
   }
@@ -425,8 +968,8 @@ void ElevenLabsStream::loop() {
   // and stopped only at the end, so is_running() is true throughout and would never let
   // either of the checks below fire.
   const bool agent_speaking = this->speaker_is_active_ ||
-                              (this->elevenlabs_speaker_ != nullptr &&
-                               this->elevenlabs_speaker_->has_buffered_data());
+                              (this->reply_speaker_ != nullptr &&
+                               this->reply_speaker_->has_buffered_data());
 
   // The agent invoked end_call. Hang up -- but only once it has stopped talking.
   //
@@ -544,6 +1087,35 @@ bool ElevenLabsStream::start_stream(const std::string &initial_message, uint32_t
   this->silence_started_ms_ = 0;
   this->end_call_requested_ = false;
   this->starting_ = true;
+  this->interrupt_pending_.store(false);
+  this->discarding_stale_audio_ = false;
+  this->audio_scanner_.set_enabled(true);
+  // The receive side is idle until connect(). stop_stream() already emptied the ring
+  // once the last conversation's socket was gone; this covers a stream that ended
+  // without it, by a dropped connection.
+  this->stopping_.store(false);
+  this->playback_sink_.clear();
+  this->audio_decoder_.reset();
+  // Until the agent says otherwise in its metadata.
+  this->uplink_active_format_.store(this->uplink_format_);
+  {
+    LockGuard guard(this->start_lock_);
+    this->start_phase_ = StartPhase::IDLE;
+  }
+  this->playback_ready_.store(false);
+  // A stop requested by stop_stream() is left pending: the playback task takes it before
+  // this conversation's start request, so the two cannot arrive out of order.
+  this->speaker_started_.store(false);
+  // The receive side is idle until connect(), so the estimator can be touched here.
+  this->jitter_.end_reply();
+  this->jitter_.reset_stats();
+  this->reply_start_delay_.reset();
+  // The connect buffer starts now; nothing from before the wake word belongs in it.
+  this->conversation_ready_.store(false);
+  this->uplink_ring_.clear();
+  if (this->connect_buffer_ms_ > 0 && this->microphone_ != nullptr) {
+    this->microphone_->start();
+  }
 
   this->connection_start_time_ = millis();
   ESP_LOGD(TAG, "START_STREAM: Connection start time set to %d", this->connection_start_time_);
@@ -576,24 +1148,12 @@ bool ElevenLabsStream::start_stream(const std::string &initial_message, uint32_t
 
       ESP_LOGD(TAG, "WS_EVENT: Starting microphone enable timeout: %u ms, %u ms grace period, %u ms since connection start, %u ms current time", timeout_duration, grace_period, time_since_connect_start, current_time);
 
+      // With a connect buffer the conversation goes live as soon as the agent's metadata
+      // arrives (see loop()); the grace period is then only the fallback.
       this->set_timeout(
         "enable_microphone", 
         timeout_duration,
-        [this]() {
-          ESP_LOGD(TAG, "WS_EVENT: Setting state to ON");
-
-          this->set_state(StreamState::ON);
-          this->starting_ = false;  // Connection established; start_stream may be called again
-          this->speaker_is_active_ = false; // Mark speaker as inactive
-          
-          ESP_LOGD(TAG, "SET_STATE: Starting microphone capture");
-          this->microphone_->start();
-
-          ESP_LOGD(TAG, "SET_STATE: Triggering start events (%zu triggers)", this->on_start_triggers_.size());
-          for (auto *trigger : this->on_start_triggers_) {
-            trigger->trigger();
-          }
-        });
+        [this]() { this->begin_conversation(); });
     },
     [this]() { 
       this->handle_websocket_disconnected(); 
@@ -611,9 +1171,50 @@ bool ElevenLabsStream::start_stream(const std::string &initial_message, uint32_t
   return true;
 }
 
+// Turns a connection into a conversation: the state goes ON, the microphone streams, and
+// whatever the connect buffer captured since the wake word is sent first.
+void ElevenLabsStream::begin_conversation() {
+  if (this->state_ == StreamState::ON || !this->starting_) {
+    return;
+  }
+  ESP_LOGD(TAG, "WS_EVENT: Setting state to ON");
+
+  this->set_state(StreamState::ON);
+  this->starting_ = false;  // Connection established; start_stream may be called again
+  this->speaker_is_active_ = false; // Mark speaker as inactive
+
+  ESP_LOGD(TAG, "SET_STATE: Starting microphone capture, %zu samples of connect buffer queued",
+           this->uplink_ring_.available());
+  this->microphone_->start();
+  if (this->uplink_task_ != nullptr) {
+    xTaskNotifyGive(this->uplink_task_);
+  }
+
+  ESP_LOGD(TAG, "SET_STATE: Triggering start events (%zu triggers)", this->on_start_triggers_.size());
+  for (auto *trigger : this->on_start_triggers_) {
+    trigger->trigger();
+  }
+}
+
+// With a connect buffer the microphone runs from start_stream() on, before there is a
+// connection. When the connection fails or drops without stop_stream(), nothing else
+// would stop it, and the device would go on capturing into the uplink ring with no
+// conversation to send it to.
+void ElevenLabsStream::stop_capture() {
+  // Not is_running(): a connect that fails at once finds the microphone still starting.
+  if (this->microphone_ != nullptr && !this->microphone_->is_stopped()) {
+    ESP_LOGD(TAG, "STOP_CAPTURE: Stopping microphone capture");
+    this->microphone_->stop();
+  }
+  this->uplink_ring_.clear();
+}
+
 void ElevenLabsStream::stop_stream() {
   ESP_LOGI(TAG, "=== STOP_STREAM CALLED ===");
   ESP_LOGI(TAG, "STOP_STREAM: Stopping ElevenLabs stream...");
+  // From here on a frame still being decoded is abandoned, so disconnect() below does
+  // not sit behind a consumer task waiting for ring space.
+  this->stopping_.store(true);
   
   // Cancel any pending timeouts to prevent issues on restart
   this->cancel_timeout("enable_microphone");
@@ -639,28 +1240,56 @@ void ElevenLabsStream::stop_stream() {
   // Release anything still held in the prebuffer first. A reply shorter than the
   // prebuffer threshold would otherwise never be played at all -- held back waiting
   // for a cushion that never arrives, then discarded here.
-  if (this->elevenlabs_speaker_ != nullptr && !this->reply_prebuffer_.empty()) {
+  // Only once the speaker has been brought up for this conversation: before that the
+  // playback task holds everything back, and waiting on it would only time out.
+  if (this->reply_speaker_ != nullptr && this->playback_ready_.load() && this->playback_sink_.available() > 0) {
     ESP_LOGD(TAG, "STOP_STREAM: Flushing %zu prebuffered bytes before stopping",
-             this->reply_prebuffer_.size());
-    this->elevenlabs_speaker_->play(this->reply_prebuffer_.data(), this->reply_prebuffer_.size(),
-                                    pdMS_TO_TICKS(SPEAKER_WRITE_WAIT_MS));
+             this->playback_sink_.available());
+    this->reply_prebuffering_ = false;
+    this->wake_playback();
     uint32_t drain_deadline = millis() + SPEAKER_DRAIN_TIMEOUT_MS;
-    while (this->elevenlabs_speaker_->has_buffered_data() && millis() < drain_deadline) {
+    while (this->playback_sink_.available() > 0 && millis() < drain_deadline) {
+      delay(10);
+    }
+    while (this->reply_speaker_->has_buffered_data() && millis() < drain_deadline) {
       delay(10);
     }
-  }
-
-  if (this->elevenlabs_speaker_ != nullptr && this->elevenlabs_speaker_->is_running()) {
-    ESP_LOGD(TAG, "STOP_STREAM: Stopping speaker to discard leftover audio");
-    this->elevenlabs_speaker_->stop();
   }
 
   // Arm the prebuffer for the next reply. Without this the next conversation would
   // hold its opening audio behind a threshold that has already been met and never
-  // release it.
-  this->reply_prebuffer_.clear();
-  this->reply_prebuffer_.shrink_to_fit();
+  // release it. Done before the speaker stops, so the playback task has nothing left
+  // to restart it for.
   this->reply_prebuffering_ = true;
+  this->playback_ready_.store(false);
+  {
+    LockGuard guard(this->start_lock_);
+    this->start_phase_ = StartPhase::IDLE;
+  }
+
+  // Stopped by the playback task, which may be inside play() on it right now. A start
+  // this conversation asked for and the task has not taken yet is withdrawn first.
+  if (this->reply_speaker_ != nullptr) {
+    ESP_LOGD(TAG, "STOP_STREAM: Stopping speaker to discard leftover audio");
+    this->speaker_start_requested_.store(false);
+    this->speaker_started_.store(false);
+    this->speaker_flush_requested_.store(true);
+    this->wake_playback();
+  }
+
+  // What feeding the speaker cost, per second of reply audio, on whichever path it took.
+  {
+    PlaybackMetrics playback = this->get_playback_metrics();
+    uint32_t bytes = playback.played_bytes - this->playback_conversation_.bytes;
+    uint32_t busy_us = playback.busy_us - this->playback_conversation_.busy_us;
+    uint32_t audio_ms = bytes / std::max<uint32_t>(this->agent_output_sample_rate_ * 2 / 1000, 1);
+    if (audio_ms > 0) {
+      ESP_LOGI(TAG, "STOP_STREAM: Played %" PRIu32 "ms of reply audio %s, %" PRIu32 " us per second of audio",
+               audio_ms, this->reply_speaker_ == this->passthrough_speaker_ ? "straight to the output" : "via the resampler",
+               (uint32_t) ((uint64_t) busy_us * 1000 / audio_ms));
+    }
+    this->playback_conversation_ = {playback.played_bytes, playback.busy_us};
+  }
 
   // Reset speaker state completely
   this->speaker_is_active_ = false;
@@ -682,6 +1311,12 @@ void ElevenLabsStream::stop_stream() {
   if (this->client_) {
     this->client_->disconnect();
   }
+  // Only now is nothing left that could decode into the ring: emptied any earlier, a
+  // frame the receive side was still handling would land in it and open the next
+  // conversation.
+  this->reply_prebuffering_ = true;
+  this->playback_sink_.clear();
+  this->audio_decoder_.reset();
   
   this->set_state(StreamState::OFF);
   ESP_LOGD(TAG, "STOP_STREAM: Triggering end events (%zu triggers)", this->on_end_triggers_.size());
@@ -727,22 +1362,103 @@ void ElevenLabsStream::renew_signed_url_if_needed() {
 }
 
 bool ElevenLabsStream::send_websocket_message(const std::string &message) {
-  if (!this->client_ || !this->client_->is_connected() || message.empty()) {
+  return this->send_websocket_message(message.c_str(), message.length());
+}
+
+bool ElevenLabsStream::send_websocket_message(const char *message, size_t length) {
+  if (!this->client_ || !this->client_->is_connected() || length == 0) {
     ESP_LOGW(TAG, "SEND_WS_MSG: Cannot send message - WebSocket not connected or message empty");
     return false;
   }
-  if (!this->client_->send_message(message)) {
+  // Bounded so that a stalled link cannot freeze the task sending -- usually the main
+  // loop. A control message that misses its window is lost; the connection is likely
+  // on its way down anyway.
+  if (!this->client_->send_message(message, length, pdMS_TO_TICKS(this->control_send_timeout_ms_))) {
+    this->control_send_failures_++;
     ESP_LOGE(TAG, "SEND_WS_MSG: Failed to send WebSocket message");
     return false;
   }
   return true;
 }
 
+// FNV-1a over a message type. constexpr so that the case labels in
+// find_message_handler() are computed by the compiler; two types that collided would
+// be a duplicate case and fail the build rather than misroute at runtime.
+static constexpr uint32_t message_type_hash(const char* type, size_t len) {
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < len; i++) {
+    hash = (hash ^ static_cast<uint8_t>(type[i])) * 16777619u;
+  }
+  return hash;
+}
+static constexpr uint32_t message_type_hash(const char* type) {
+  return message_type_hash(type, std::char_traits<char>::length(type));
+}
+
+// Routes a message type to its handler. This used to be a chain of strcmp calls that
+// every control message walked from the top; the hash picks the one candidate and a
+// single strcmp confirms it, so a type the agent adds later cannot alias a known one.
+ElevenLabsStream::MessageHandler ElevenLabsStream::find_message_handler(const JsonSpan &type) {
+  const char* name = nullptr;
+  MessageHandler handler = nullptr;
+  switch (message_type_hash(type.data, type.len)) {
+    case message_type_hash("conversation_initiation_metadata"):
+      name = "conversation_initiation_metadata";
+      handler = &ElevenLabsStream::handle_conversation_metadata;
+      break;
+    case message_type_hash("audio"):
+      name = "audio";
+      handler = &ElevenLabsStream::handle_audio_message;
+      break;
+    case message_type_hash("user_transcript"):
+      name = "user_transcript";
+      handler = &ElevenLabsStream::handle_user_transcript;
+      break;
+    case message_type_hash("agent_response"):
+      name = "agent_response";
+      handler = &ElevenLabsStream::handle_agent_response;
+      break;
+    case message_type_hash("vad_score"):
+      name = "vad_score";
+      handler = &ElevenLabsStream::handle_vad_score;
+      break;
+    case message_type_hash("interruption"):
+      name = "interruption";
+      handler = &ElevenLabsStream::handle_interruption;
+      break;
+    case message_type_hash("ping"):
+      name = "ping";
+      handler = &ElevenLabsStream::handle_ping;
+      break;
+    case message_type_hash("mcp_connection_status"):
+      name = "mcp_connection_status";
+      handler = &ElevenLabsStream::handle_mcp_connection_status;
+      break;
+    case message_type_hash("agent_tool_response"):
+      name = "agent_tool_response";
+      handler = &ElevenLabsStream::handle_agent_tool_response;
+      break;
+    default:
+      return nullptr;
+  }
+  return type.equals(name) ? handler : nullptr;
+}
+
+// Dumps a whole message to the log, straight from the receive buffer. Messages that
+// went through the ArduinoJson fallback have had that buffer rewritten and are skipped.
+// Only exists in builds that can print it.
+void ElevenLabsStream::log_message_verbose(const ControlMessage &msg) {
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_VERBOSE
+  if (msg.raw.present()) {
+    ESP_LOGV(TAG, "PARSE_JSON_BUF: JSON: %.*s", (int) msg.raw.len, msg.raw.data);
+  }
+#endif
+}
+
 void ElevenLabsStream::parse_json_message_from_buffer(uint8_t *buffer, size_t length) {
-  // Log PSRAM before parsing
-  size_t psram_free_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing message, length=%zu, PSRAM Free=%zuKB", 
-           length, psram_free_before / 1024);
+  // No heap probes per message: heap_caps_get_free_size() walks the heap under its lock,
+  // several times a second here. loop() reports PSRAM every few seconds instead.
+  ESP_LOGV(TAG, "PARSE_JSON_BUF: Processing message, length=%zu", length);
   
   // Fast path for audio frames: extract the base64 payload without parsing the JSON.
   //
@@ -757,390 +1473,353 @@ void ElevenLabsStream::parse_json_message_from_buffer(uint8_t *buffer, size_t le
   // scanning. That avoids allocating any document for the largest, most frequent
   // messages. Everything else -- small control frames -- still goes through the
   // parser below, where correctness matters more than bytes.
-  static const char AUDIO_KEY[] = "\"audio_base_64\"";
-  const size_t AUDIO_KEY_LEN = sizeof(AUDIO_KEY) - 1;
+  //
+  // Most audio frames never get here: audio_scanner_ takes them fragment by fragment as
+  // they arrive. What remains are frames that arrived while the previous message was
+  // still being handled, which are assembled first so the two cannot overtake.
   const char* haystack = reinterpret_cast<const char*>(buffer);
-  // Hand-rolled rather than memmem(), which is a GNU extension and not dependable on
-  // ESP-IDF. The key appears early in the frame, so this scans a few bytes in practice.
-  const char* key_pos = nullptr;
-  if (length >= AUDIO_KEY_LEN) {
-    for (size_t i = 0; i + AUDIO_KEY_LEN <= length; i++) {
-      if (haystack[i] == '"' && memcmp(haystack + i, AUDIO_KEY, AUDIO_KEY_LEN) == 0) {
-        key_pos = haystack + i;
-        break;
-      }
-    }
-  }
-  if (key_pos != nullptr) {
+  ptrdiff_t value_offset = AudioFrameScanner::find_payload(haystack, length);
+  // Not after an interruption, though: the frame's event_id is needed to tell stale
+  // audio from the next response, and the fast path never looks at it.
+  if (value_offset >= 0 && !this->discarding_stale_audio_) {
     const char* end = haystack + length;
-    const char* p = key_pos + sizeof(AUDIO_KEY) - 1;
-    while (p < end && *p != ':') p++;          // key -> colon
-    while (p < end && *p != '"') p++;          // colon -> opening quote
-    if (p < end) {
-      const char* value_start = p + 1;
-      const char* value_end = static_cast<const char*>(memchr(value_start, '"', end - value_start));
-      if (value_end != nullptr && value_end > value_start) {
-        // decode_and_play_base64_audio takes a C string; terminate in place. The
-        // buffer belongs to the websocket assembler and is reset after this returns.
-        size_t payload_len = value_end - value_start;
-        *const_cast<char*>(value_end) = '\0';
-        ESP_LOGD(TAG, "PARSE_JSON_BUF: Audio fast path, payload=%zu bytes (frame %zu)", payload_len, length);
-        this->last_audio_time_ = millis();
-        this->decode_and_play_base64_audio(value_start);
-        return;
-      }
+    const char* value_start = haystack + value_offset;
+    const char* value_end = static_cast<const char*>(memchr(value_start, '"', end - value_start));
+    if (value_end != nullptr && value_end > value_start) {
+      // The bounds are already known, so the payload is handed over by length rather
+      // than terminated and measured again with strlen.
+      size_t payload_len = value_end - value_start;
+      ESP_LOGD(TAG, "PARSE_JSON_BUF: Audio fast path, payload=%zu bytes (frame %zu)", payload_len, length);
+      this->decode_assembled_audio_frame(value_start, payload_len);
+      return;
     }
     ESP_LOGW(TAG, "PARSE_JSON_BUF: audio_base_64 present but unparseable; falling back to JSON");
   }
 
-  // Use new JsonDeserializer class
-  auto json_doc = JsonDeserializer::parse(buffer, length);
-  if (!json_doc) {
-    ESP_LOGE(TAG, "PARSE_JSON_BUF: Failed to parse JSON buffer of length %zu", length);
-    return;
+  // Control messages are read in place first; see control_message.h. ArduinoJson is
+  // only brought in for what the reader turns down.
+  //
+  // vad_score and ping, which make up most of the traffic between audio frames, are
+  // picked out by a bounded scan before that.
+  ControlMessage msg;
+  JsonDocumentPool::Lease json_doc;
+  if (scan_frequent_control_message(reinterpret_cast<const char*>(buffer), length, msg) ||
+      parse_control_message(reinterpret_cast<const char*>(buffer), length, msg)) {
+    msg.raw = JsonSpan{reinterpret_cast<const char*>(buffer), length};
+  } else {
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: Control message reader declined %zu bytes, falling back to JSON", length);
+    json_doc = JsonDeserializer::parse(buffer, length, this->json_pool_);
+    if (!json_doc) {
+      ESP_LOGE(TAG, "PARSE_JSON_BUF: Failed to parse JSON buffer of length %zu", length);
+      return;
+    }
+    control_message_from_json(json_doc->as<JsonObject>(), msg);
   }
-  
-  // Log PSRAM after parsing
-  size_t psram_free_after = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-  size_t psram_delta = psram_free_before - psram_free_after;
-  ESP_LOGD(TAG, "PARSE_JSON_BUF: JSON parsed, PSRAM Free=%zuKB (-%zuKB)", 
-           psram_free_after / 1024, psram_delta / 1024);
-  JsonObject root = json_doc->as<JsonObject>();
-  const char* type = root["type"];
-  if (!type) {
+
+  if (!msg.type.present()) {
     ESP_LOGW(TAG, "PARSE_JSON_BUF: Message missing type field");
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Available root fields:");
-    for (JsonPair kv : root) {
-      ESP_LOGD(TAG, "PARSE_JSON_BUF:   - %s", kv.key().c_str());
-    }
+    log_message_verbose(msg);
     return;
   }
   
-  ESP_LOGV(TAG, "PARSE_JSON_BUF: Message type: '%s'", type);
-  
-  // Handle conversation_initiation_metadata
-  if (strcmp(type, "conversation_initiation_metadata") == 0) {
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing conversation_initiation_metadata");
-    JsonObject metadata = root["conversation_initiation_metadata_event"];
-    if (metadata) {
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: Found conversation_initiation_metadata_event");
-      const char* conversation_id = metadata["conversation_id"];
-      const char* agent_output_format = metadata["agent_output_audio_format"];
-      const char* user_input_format = metadata["user_input_audio_format"];
-      
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: conversation_id=%s", conversation_id ? conversation_id : "NULL");
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: agent_output_format=%s", agent_output_format ? agent_output_format : "NULL");
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: user_input_format=%s", user_input_format ? user_input_format : "NULL");
-      
-      if (conversation_id) { //we don't listen right now temporarily - this has always been disabled, since we are only testing playback for the initial message right now.
-        this->conversation_id_ = conversation_id;
-        ESP_LOGI(TAG, "PARSE_JSON_BUF: Conversation initiated: %s", conversation_id);
-        
-        // Store audio formats
-        if (agent_output_format) {
-          this->agent_output_audio_format_ = agent_output_format;
-          ESP_LOGD(TAG, "PARSE_JSON_BUF: Agent output format: %s", agent_output_format);
-        }
-        if (user_input_format) {
-          this->user_input_audio_format_ = user_input_format;
-          ESP_LOGD(TAG, "PARSE_JSON_BUF: User input format: %s", user_input_format);
-        }
-          
-        // Configure the speaker with the correct input format
-        if (!this->activation_speaker_audio_stream_infoset_) {
-          this->activation_speaker_audio_stream_info = this->activation_speaker_->get_audio_stream_info();
-          this->activation_speaker_audio_stream_infoset_ = true;
-
-          ESP_LOGI(TAG, 
-            "PARSE_JSON_BUF: Initial audio stream info set: %d Hz, %d channels, %d bits per sample", 
-            this->activation_speaker_audio_stream_info.get_sample_rate(),
-            this->activation_speaker_audio_stream_info.get_channels(),
-            this->activation_speaker_audio_stream_info.get_bits_per_sample());
-        
-          // while the speaker is running, do not change the audio stream info
-          while (this->activation_speaker_->is_running() || this->elevenlabs_speaker_->is_running() || this->activation_speaker_->has_buffered_data() || 
-                 this->elevenlabs_speaker_->has_buffered_data())
-          {
-            ESP_LOGD(TAG, "PARSE_JSON_BUF: Waiting for activation speaker to stop before changing audio stream info");
-            delay(100); // Wait until the speaker is stopped
-          }
-          
-          // The stream info is applied unconditionally just below, on every
-          // conversation. Setting it here as well meant two calls in quick succession
-          // on the first conversation after boot, and a second set_audio_stream_info()
-          // can restart a speaker that already has audio queued -- which is heard as
-          // the opening syllable played twice ("Na- Naturally"). One call, one place.
-        }
+  ESP_LOGV(TAG, "PARSE_JSON_BUF: Message type: '%.*s'", (int) msg.type.len, msg.type.data);
 
-        // Let the activation chime finish before any reply audio is queued.
-        //
-        // The chime plays on activation_speaker while the reply plays on
-        // elevenlabs_speaker, and both feed the same i2s output. Overlapping them
-        // costs the first moment of speech: observed as a gap between "Naturally" and
-        // "sir", or a doubled opening syllable, always inside the first second and
-        // roughly one run in five.
-        //
-        // The block above waits for exactly this, but it is guarded by
-        // activation_speaker_audio_stream_infoset_, which is set on the first
-        // conversation after boot and never cleared -- so every subsequent
-        // conversation raced the chime. Wait here on every conversation.
-        {
-          uint32_t chime_deadline = millis() + ACTIVATION_CHIME_TIMEOUT_MS;
-          bool waited = false;
-          while ((this->activation_speaker_->is_running() || this->activation_speaker_->has_buffered_data()) &&
-                 millis() < chime_deadline) {
-            waited = true;
-            delay(10);
-          }
-          if (waited) {
-            ESP_LOGD(TAG, "PARSE_JSON_BUF: Waited for the activation chime to finish before playing the reply");
-          }
-
-          // Then give the i2s peripheral time to actually drain.
-          //
-          // The loop above asks the RESAMPLER whether it is done, but both speakers
-          // feed one shared i2s_audio_speaker, and i2s keeps emitting for a short
-          // while after the resampler reports empty. Reply audio starting inside that
-          // window collides with the chime tail, which is heard as a gap partway
-          // through the first word -- the last artifact still failing 2 runs in 10,
-          // with an identical signature every time.
-          //
-          // There is no handle on the shared i2s device from here, so this is a fixed
-          // settle time rather than a state check. It costs the same delay on every
-          // reply, which is the price of not having something better to poll.
-          delay(I2S_DRAIN_SETTLE_MS);
-        }
+  MessageHandler handler = find_message_handler(msg.type);
+  if (handler == nullptr) {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: Unknown message type: '%.*s'", (int) msg.type.len, msg.type.data);
+    log_message_verbose(msg);
+    return;
+  }
+  (this->*handler)(msg);
+}
 
-        // Bring the speaker up NOW, before any audio arrives, and do it on every
-        // conversation rather than only the first.
-        //
-        // Starting it lazily on the first chunk is inherently racy and the race is
-        // audible either way: writing before it is running loses the opening syllable
-        // ("Naturally" as "urally"), while starting and waiting inside the write path
-        // instead produced a repeat ("Na-naturally"). Doing it here removes the
-        // transition from the audio path entirely -- by the time the first frame
-        // lands, the speaker has been running for a while.
-        //
-        // Deliberately outside the infoset_ guard above, which only fires once per
-        // boot; every conversation needs a running speaker.
-        if (this->elevenlabs_speaker_ != nullptr) {
-          // Reapply the stream info every conversation, not just the first.
-          //
-          // stop_stream() now stops the speaker between conversations, and a stopped
-          // speaker does not necessarily retain the input rate configured for it. The
-          // original call sits inside the infoset_ guard above, which fires once per
-          // boot, so every later conversation started a speaker that had never been
-          // told the agent's format again. Reconfiguring before start() is cheap and
-          // removes the guesswork.
-          this->set_speaker_stream_info_to_elevenlabs_format();
-
-          if (!this->elevenlabs_speaker_->is_running()) {
-            ESP_LOGI(TAG, "PARSE_JSON_BUF: Starting elevenlabs speaker ahead of the first audio frame");
-            this->elevenlabs_speaker_->start();
+void ElevenLabsStream::handle_conversation_metadata(const ControlMessage &msg) {
+  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing conversation_initiation_metadata");
+  if (msg.metadata_event) {
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: Found conversation_initiation_metadata_event");
+    const JsonSpan &conversation_id = msg.conversation_id;
+    const JsonSpan &agent_output_format = msg.agent_output_audio_format;
+    const JsonSpan &user_input_format = msg.user_input_audio_format;
+    
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: conversation_id=%.*s", (int) conversation_id.len, conversation_id.present() ? conversation_id.data : "");
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: agent_output_format=%.*s", (int) agent_output_format.len, agent_output_format.present() ? agent_output_format.data : "");
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: user_input_format=%.*s", (int) user_input_format.len, user_input_format.present() ? user_input_format.data : "");
+    
+    if (conversation_id.present()) { //we don't listen right now temporarily - this has always been disabled, since we are only testing playback for the initial message right now.
+      this->conversation_id_ = conversation_id.str();
+      ESP_LOGI(TAG, "PARSE_JSON_BUF: Conversation initiated: %s", this->conversation_id_.c_str());
+      
+      // Store audio formats
+      if (agent_output_format.present()) {
+        this->agent_output_audio_format_ = agent_output_format.str();
+        ESP_LOGD(TAG, "PARSE_JSON_BUF: Agent output format: %s", this->agent_output_audio_format_.c_str());
+      }
+      if (user_input_format.present()) {
+        this->user_input_audio_format_ = user_input_format.str();
+        ESP_LOGD(TAG, "PARSE_JSON_BUF: User input format: %s", this->user_input_audio_format_.c_str());
+
+        // The agent decodes whatever arrives as the format it announced, so that is what
+        // the uplink sends. uplink_codec only covers the audio before this point and
+        // formats the uplink cannot produce.
+        UplinkFormat format;
+        if (!parse_uplink_format(user_input_format.data, user_input_format.len, format)) {
+          ESP_LOGW(TAG, "PARSE_JSON_BUF: Agent expects %s, which the uplink cannot send; sending %s",
+                   this->user_input_audio_format_.c_str(), uplink_format_name(this->uplink_format_));
+        } else {
+          if (format != this->uplink_format_) {
+            ESP_LOGW(TAG, "PARSE_JSON_BUF: Agent expects %s but uplink_codec is %s; following the agent",
+                     uplink_format_name(format), uplink_format_name(this->uplink_format_));
           }
+          this->uplink_active_format_.store(format);
         }
-      } else {
-        ESP_LOGW(TAG, "PARSE_JSON_BUF: No conversation_id in metadata");
       }
+        
+      // Bringing the speaker up takes a few hundred milliseconds of waiting on the
+      // activation chime and the i2s output. That used to happen right here, in
+      // delay() steps, with the socket frozen meanwhile; now the speakers' own reports
+      // step through it while the first frames keep arriving. See
+      // request_start_sequence().
+      this->request_start_sequence();
     } else {
-      ESP_LOGW(TAG, "PARSE_JSON_BUF: No conversation_initiation_metadata_event found");
+      ESP_LOGW(TAG, "PARSE_JSON_BUF: No conversation_id in metadata");
     }
-    return;
+    // Last, so the connect buffer goes out in the input format just agreed.
+    this->conversation_ready_.store(true);
+  } else {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: No conversation_initiation_metadata_event found");
   }
-  
-  // Handle audio events (corrected type name)
-  if (strcmp(type, "audio") == 0) {
-    JsonObject audio = root["audio_event"];
-    if (audio) {
-      const char* audio_base64 = audio["audio_base_64"];
-      uint32_t event_id = audio["event_id"] | 0;
+}
+
+void ElevenLabsStream::handle_audio_message(const ControlMessage &msg) {
+  if (msg.audio_event && this->discarding_stale_audio_) {
+    // Frames the agent had already sent when it was interrupted keep arriving for a
+    // moment. They belong to the response the user talked over. Only a frame that says
+    // it is newer ends the discard; one without an event_id cannot tell, so it goes too.
+    if (!msg.has_event_id || msg.event_id <= this->interrupted_event_id_) {
+      if (msg.has_event_id) {
+        ESP_LOGD(TAG, "BARGE_IN: Dropping audio from event %" PRIu32 ", interrupted at %" PRIu32, msg.event_id,
+                 this->interrupted_event_id_);
+      } else {
+        ESP_LOGD(TAG, "BARGE_IN: Dropping audio without an event_id, interrupted at %" PRIu32,
+                 this->interrupted_event_id_);
+      }
+      return;
+    }
+    // The agent's next response: frames can be streamed again.
+    this->discarding_stale_audio_ = false;
+    this->audio_scanner_.set_enabled(true);
+  }
+  if (msg.audio_event) {
+    const JsonSpan &audio_base64 = msg.audio_base_64;
+    
+    if (audio_base64.present()) {
+      size_t base64_len = audio_base64.len;
+      ESP_LOGD(TAG, "AUDIO_EVENT: Processing audio chunk, base64_len=%zu", base64_len);
       
-      if (audio_base64) {
-        size_t base64_len = strlen(audio_base64);
-        size_t psram_before_audio = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-        ESP_LOGD(TAG, "AUDIO_EVENT: Processing audio chunk, base64_len=%zu, PSRAM Free=%zuKB", 
-                 base64_len, psram_before_audio / 1024);
-        
-        // Update timing for state management
-        this->last_audio_response_time_ = millis();
+      // Update timing for state management
+      this->last_audio_response_time_ = millis();
 
-        // speaker_is_active_ and the replying triggers are handled inside
-        // decode_and_play_base64_audio, which both this branch and the fast path share.
+      // speaker_is_active_ and the replying triggers are handled inside
+      // decode_assembled_audio_frame, which both this branch and the fast path share.
 
-        // Decode base64 audio data and play it immediately
-        bool decode_success = this->decode_and_play_base64_audio(audio_base64);
-        if (!decode_success) {
-          ESP_LOGW(TAG, "PARSE_JSON_BUF: Failed to decode audio data");
-        }
-        
-        // Log PSRAM after audio processing
-        size_t psram_after_audio = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-        size_t psram_audio_delta = psram_before_audio - psram_after_audio;
-        ESP_LOGD(TAG, "AUDIO_EVENT: Audio processed, PSRAM Free=%zuKB (-%zuKB)", 
-                 psram_after_audio / 1024, psram_audio_delta / 1024);
+      // Decode base64 audio data into the playback ring
+      bool decode_success = this->decode_assembled_audio_frame(audio_base64.data, base64_len);
+      if (!decode_success) {
+        ESP_LOGW(TAG, "PARSE_JSON_BUF: Failed to decode audio data");
       }
     }
-    return;
   }
-  
-  // Handle user transcript
-  if (strcmp(type, "user_transcript") == 0) {
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing user_transcript");
-    JsonObject transcript = root["user_transcription_event"];
-    if (transcript) {
-      const char* user_transcript = transcript["user_transcript"];
-      if (user_transcript) {
-        ESP_LOGI(TAG, "PARSE_JSON_BUF: User transcript: '%s'", user_transcript);
-
-        // Somebody answered the announcement, so stop policing it. A transcript is the
-        // one unambiguous signal available -- vad_score only ever says something
-        // speech-shaped was heard -- and past this point the exchange is an ordinary
-        // conversation that should live or die by the agent's own settings, not by a
-        // three second window meant to catch an empty room.
-        if (this->awaiting_response_ && user_transcript[0] != '\0') {
-          ESP_LOGI(TAG, "PARSE_JSON_BUF: Announcement was answered, dropping the reply window");
-          this->awaiting_response_ = false;
-          this->silence_started_ms_ = 0;
-        }
-      } else {
-        ESP_LOGW(TAG, "PARSE_JSON_BUF: No user_transcript in user_transcription_event");
+}
+
+void ElevenLabsStream::handle_user_transcript(const ControlMessage &msg) {
+  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing user_transcript");
+  if (msg.transcript_event) {
+    const JsonSpan &user_transcript = msg.user_transcript;
+    if (user_transcript.present()) {
+      ESP_LOGI(TAG, "PARSE_JSON_BUF: User transcript: '%.*s'", (int) user_transcript.len, user_transcript.data);
+
+      // Somebody answered the announcement, so stop policing it. A transcript is the
+      // one unambiguous signal available -- vad_score only ever says something
+      // speech-shaped was heard -- and past this point the exchange is an ordinary
+      // conversation that should live or die by the agent's own settings, not by a
+      // three second window meant to catch an empty room.
+      if (this->awaiting_response_ && !user_transcript.empty()) {
+        ESP_LOGI(TAG, "PARSE_JSON_BUF: Announcement was answered, dropping the reply window");
+        this->awaiting_response_ = false;
+        this->silence_started_ms_ = 0;
       }
     } else {
-      ESP_LOGW(TAG, "PARSE_JSON_BUF: No user_transcription_event found");
+      ESP_LOGW(TAG, "PARSE_JSON_BUF: No user_transcript in user_transcription_event");
     }
-    return;
+  } else {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: No user_transcription_event found");
   }
-  
-  // Handle agent response
-  if (strcmp(type, "agent_response") == 0) {
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing agent_response");
-    JsonObject response = root["agent_response_event"];
-    if (response) {
-      const char* agent_response = response["agent_response"];
-      if (agent_response) {
-        ESP_LOGI(TAG, "PARSE_JSON_BUF: Agent response: '%s'", agent_response);
-        // Could trigger an event here for response handling
-      } else {
-        ESP_LOGW(TAG, "PARSE_JSON_BUF: No agent_response in agent_response_event");
-      }
+}
+
+void ElevenLabsStream::handle_agent_response(const ControlMessage &msg) {
+  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing agent_response");
+  if (msg.response_event) {
+    const JsonSpan &agent_response = msg.agent_response;
+    if (agent_response.present()) {
+      ESP_LOGI(TAG, "PARSE_JSON_BUF: Agent response: '%.*s'", (int) agent_response.len, agent_response.data);
+      // Could trigger an event here for response handling
     } else {
-      ESP_LOGW(TAG, "PARSE_JSON_BUF: No agent_response_event found");
+      ESP_LOGW(TAG, "PARSE_JSON_BUF: No agent_response in agent_response_event");
     }
-    return;
+  } else {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: No agent_response_event found");
   }
-  
-  // Handle VAD score
-  if (strcmp(type, "vad_score") == 0) {
-    JsonObject vad = root["vad_score_event"];
-    if (vad) {
-      float vad_score = vad["vad_score"] | 0.0f;
-      if(this->speaker_is_active_) {
-        return; // Skip invalid scores
-      }
+}
 
-      float led_threshold = 0.25f;
-      if(vad_score > led_threshold) {
-        if(this->last_vad_score_ <= led_threshold) {
-          for (auto *trigger : this->on_listening_triggers_) {
-              trigger->trigger();
-          }
+void ElevenLabsStream::handle_vad_score(const ControlMessage &msg) {
+  if (msg.vad_event) {
+    float vad_score = msg.vad_score;
+    if(this->speaker_is_active_) {
+      return; // Skip invalid scores
+    }
+
+    float led_threshold = 0.25f;
+    if(vad_score > led_threshold) {
+      if(this->last_vad_score_ <= led_threshold) {
+        for (auto *trigger : this->on_listening_triggers_) {
+            trigger->trigger();
         }
-      } else {
-        if(this->last_vad_score_ > led_threshold) {
-          for (auto *trigger : this->on_processing_triggers_) {
-              trigger->trigger();
-          }
+      }
+    } else {
+      if(this->last_vad_score_ > led_threshold) {
+        for (auto *trigger : this->on_processing_triggers_) {
+            trigger->trigger();
         }
       }
+    }
 
-      this->last_vad_score_ = vad_score;
+    this->last_vad_score_ = vad_score;
 
-      // Hold off the announcement hang-up while the service thinks it can hear someone.
-      //
-      // Deliberately a stricter threshold than the ring's 0.25. The LED is meant to be
-      // twitchy -- lighting up early feels responsive and costs nothing if it is wrong
-      // -- but the same twitchiness applied here would let a fridge hum or a passing car
-      // hold the call open indefinitely. This only needs to catch a person starting to
-      // answer, and a false negative merely ends a conversation nobody was having.
-      if (this->awaiting_response_ && vad_score >= ANNOUNCEMENT_SPEECH_THRESHOLD) {
-        if (this->silence_started_ms_ != 0) {
-          ESP_LOGD(TAG, "PARSE_JSON_BUF: Speech detected (VAD %.2f), holding the announcement open",
-                   vad_score);
-        }
-        this->silence_started_ms_ = 0;
+    // Hold off the announcement hang-up while the service thinks it can hear someone.
+    //
+    // Deliberately a stricter threshold than the ring's 0.25. The LED is meant to be
+    // twitchy -- lighting up early feels responsive and costs nothing if it is wrong
+    // -- but the same twitchiness applied here would let a fridge hum or a passing car
+    // hold the call open indefinitely. This only needs to catch a person starting to
+    // answer, and a false negative merely ends a conversation nobody was having.
+    if (this->awaiting_response_ && vad_score >= ANNOUNCEMENT_SPEECH_THRESHOLD) {
+      if (this->silence_started_ms_ != 0) {
+        ESP_LOGD(TAG, "PARSE_JSON_BUF: Speech detected (VAD %.2f), holding the announcement open",
+                 vad_score);
       }
-
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: VAD score: %.2f", vad_score);
-    } else {
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: No vad_score_event found");
+      this->silence_started_ms_ = 0;
     }
-    return;
+
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: VAD score: %.2f", vad_score);
+  } else {
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: No vad_score_event found");
   }
-  
-  // Handle interruption
-  if (strcmp(type, "interruption") == 0) {
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing interruption event");
-    JsonObject interruption = root["interruption_event"];
-    if (interruption) {
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: Interruption event received");
-    } else {
-      ESP_LOGW(TAG, "PARSE_JSON_BUF: No interruption_event found");
-    }
+}
+
+void ElevenLabsStream::handle_interruption(const ControlMessage &msg) {
+  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing interruption event");
+  if (msg.interruption_event) {
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: Interruption event received");
+  } else {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: No interruption_event found");
+    // observe_message() may have held playback back on the strength of the key alone.
+    this->interrupt_pending_.store(false);
+    this->wake_playback();
     return;
   }
-  
-  // Handle ping with proper response
-  if (strcmp(type, "ping") == 0) {
-    JsonObject ping = root["ping_event"];
-    if (ping) {
-      uint32_t event_id = ping["event_id"] | 0;
-      uint32_t ping_ms = ping["ping_ms"] | 0;
-      
-      // Send pong response with event_id
-      std::string pong_message = json::build_json([event_id](JsonObject root) {
-        root["type"] = "pong";
-        root["event_id"] = event_id;
-      });
-      this->send_websocket_message(pong_message);
-    } else {
-      ESP_LOGW(TAG, "PARSE_JSON_BUF: No ping_event found");
-    }
+  if (!this->barge_in_) {
     return;
   }
-  
-  std::string json_str = JsonDeserializer::to_string(root);
-  if (strcmp(type, "mcp_connection_status") == 0) {
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing MCP connection status: '%s'", json_str.c_str());
-    JsonObject status = root["mcp_connection_status"];
-    //TODO: handle MCP processing
+
+  // The service heard the user talk over the reply and has stopped generating it. Stop
+  // playing it too, now: everything between the decoder and the i2s output still holds
+  // seconds of it, and draining that is what made the agent seem to ignore being
+  // interrupted.
+  this->flush_reply_audio();
+  if (msg.has_event_id) {
+    this->interrupted_event_id_ = msg.event_id;
+    this->discarding_stale_audio_ = true;
+    this->audio_scanner_.set_enabled(false);
+  }
+  this->interrupt_pending_.store(false);
+  // 0 when the message was too long for observe_message() to look at.
+  uint32_t spotted_ms = this->interrupt_spotted_ms_.exchange(0);
+  ESP_LOGI(TAG, "BARGE_IN: Reply interrupted at event %" PRIu32 ", audio flushed %" PRIu32 "ms after it arrived",
+           msg.has_event_id ? msg.event_id : 0, spotted_ms != 0 ? millis() - spotted_ms : 0);
+}
+
+// Throws away all reply audio the device holds: the frame being decoded, the playback
+// ring and whatever the speaker has buffered. Receive side only.
+//
+// The speaker itself is left to the playback task, which may be inside play() on it at
+// this moment; ESPHome speakers are not safe to drive from two tasks at once.
+void ElevenLabsStream::flush_reply_audio() {
+  this->audio_decoder_.reset();
+  this->reply_prebuffering_ = true;
+  this->playback_sink_.clear();
+  this->speaker_flush_requested_.store(true);
+  this->wake_playback();
+}
+
+// Runs on the websocket task as each message is assembled, ahead of the queue.
+//
+// While a reply plays, the consumer task can spend most of its time waiting for room in
+// the playback ring, and an interruption queued behind the audio it is decoding would
+// wait for all of it. Spotting it here lets those waits give up at once.
+void ElevenLabsStream::observe_message(const uint8_t* data, size_t len) {
+  static const char INTERRUPTION_KEY[] = "\"interruption_event\"";
+  static const size_t KEY_LEN = sizeof(INTERRUPTION_KEY) - 1;
+  if (len > INTERRUPTION_SCAN_LIMIT) {
     return;
   }
+  const char* chars = reinterpret_cast<const char*>(data);
+  for (const char* p = chars; p + KEY_LEN <= chars + len; p++) {
+    if (*p == '"' && memcmp(p, INTERRUPTION_KEY, KEY_LEN) == 0) {
+      this->interrupt_spotted_ms_.store(millis());
+      this->interrupt_pending_.store(true);
+      return;
+    }
+  }
+}
 
-  if(strcmp(type, "agent_tool_response") == 0) {
-    ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing agent_tool_response: '%s'", json_str.c_str());
-    JsonObject tool_response = root["agent_tool_response"];
-    if (tool_response) {
-      const char* tool_name = tool_response["tool_name"];
-      ESP_LOGD(TAG, "PARSE_JSON_BUF: Tool response - Name: %s", 
-               tool_name ? tool_name : "NULL");
-
-      // end_call is the agent agreeing to hang up, and it is the only notice given:
-      // ElevenLabs sends no conversation-ended event. Record it and let loop() do the
-      // teardown once the farewell has played -- stop_stream() destroys the websocket
-      // client, and this runs on the websocket's own task.
-      if (tool_name != nullptr && strcmp(tool_name, "end_call") == 0) {
-        ESP_LOGI(TAG, "PARSE_JSON_BUF: Agent invoked end_call; will end the conversation once it stops speaking");
-        this->end_call_requested_ = true;
-        this->end_call_requested_ms_ = millis();
-      }
-    } else {
-      ESP_LOGW(TAG, "PARSE_JSON_BUF: No agent_tool_response_event found");
+void ElevenLabsStream::handle_ping(const ControlMessage &msg) {
+  if (msg.ping_event) {
+    // Only the event_id changes from one pong to the next, so it is written after the
+    // fixed prefix rather than building a JSON document per ping.
+    char *end = this->pong_message_ + PONG_PREFIX_LEN;
+    end += snprintf(end, sizeof(this->pong_message_) - PONG_PREFIX_LEN, "%" PRIu32 "}", msg.event_id);
+    this->send_websocket_message(this->pong_message_, end - this->pong_message_);
+  } else {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: No ping_event found");
+  }
+}
+
+void ElevenLabsStream::handle_mcp_connection_status(const ControlMessage &msg) {
+  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing MCP connection status");
+  log_message_verbose(msg);
+  //TODO: handle MCP processing
+}
+
+void ElevenLabsStream::handle_agent_tool_response(const ControlMessage &msg) {
+  ESP_LOGD(TAG, "PARSE_JSON_BUF: Processing agent_tool_response");
+  log_message_verbose(msg);
+  if (msg.tool_response_event) {
+    const JsonSpan &tool_name = msg.tool_name;
+    ESP_LOGD(TAG, "PARSE_JSON_BUF: Tool response - Name: %.*s", 
+             (int) tool_name.len, tool_name.present() ? tool_name.data : "");
+
+    // end_call is the agent agreeing to hang up, and it is the only notice given:
+    // ElevenLabs sends no conversation-ended event. Record it and let loop() do the
+    // teardown once the farewell has played -- stop_stream() destroys the websocket
+    // client, and this runs on its receive task, which disconnect() waits for.
+    if (tool_name.equals("end_call")) {
+      ESP_LOGI(TAG, "PARSE_JSON_BUF: Agent invoked end_call; will end the conversation once it stops speaking");
+      this->end_call_requested_ = true;
+      this->end_call_requested_ms_ = millis();
     }
-    return;
+  } else {
+    ESP_LOGW(TAG, "PARSE_JSON_BUF: No agent_tool_response_event found");
   }
-  
-  // Log unknown message types for debugging
-  ESP_LOGW(TAG, "PARSE_JSON_BUF: Unknown message type: '%s', JSON: %s", type, json_str.c_str());
 }
 
 // Handles errors, logs details, and triggers error automations.
@@ -1163,6 +1842,7 @@ void ElevenLabsStream::handle_error(const std::string &error_message) {
   this->starting_ = false;
   this->end_call_requested_ = false;
   this->set_state(StreamState::OFF);
+  this->stop_capture();
   ESP_LOGD(TAG, "ERROR: Triggering error events (%zu triggers)", this->on_error_triggers_.size());
   for (auto *trigger : this->on_error_triggers_) {
     ESP_LOGD(TAG, "ERROR: Triggering error event at %p with message: '%s'", trigger, error_message.c_str());
@@ -1194,6 +1874,12 @@ void ElevenLabsStream::send_conversation_init() {
     // Use custom initial message if provided, otherwise use empty string
     agent["first_message"] = this->initial_message_.empty() ? "" : this->initial_message_.c_str();
 
+    // Ask for the output format that plays without resampling. Opt-in: the agent has to
+    // allow this override in its security settings, or ElevenLabs ends the conversation.
+    if (!this->request_output_format_.empty()) {
+      tts["agent_output_audio_format"] = this->request_output_format_.c_str();
+    }
+
     // Nothing about the silence window is sent here. turn.silence_end_call_timeout is
     // not in the overridable set, and ElevenLabs errors a conversation that arrives with
     // an override it does not accept -- so asking for it would not merely be ignored, it
@@ -1224,6 +1910,325 @@ void ElevenLabsStream::send_ping() {
   this->send_websocket_message(message);
 }
 
+void ElevenLabsStream::uplink_task(void* arg) {
+  ElevenLabsStream* self = static_cast<ElevenLabsStream*>(arg);
+  TickType_t wait = portMAX_DELAY;
+  while (true) {
+    // Woken by every block the microphone queues; the timeout is the aggregation
+    // deadline for audio that is already waiting.
+    ulTaskNotifyTake(pdTRUE, wait);
+    const uint32_t started_us = micros();
+    wait = self->service_uplink();
+    self->uplink_busy_us_ += micros() - started_us;
+  }
+}
+
+// Encodes `count` samples into a user_audio_chunk frame and sends it. Uplink task only.
+bool ElevenLabsStream::send_uplink_frame(const int16_t* samples, size_t count) {
+  const uint8_t* audio_bytes = reinterpret_cast<const uint8_t*>(samples);
+  size_t audio_size = count * sizeof(int16_t);
+  if (this->uplink_active_format_.load() == UplinkFormat::ULAW_8000) {
+    if (this->uplink_encoded_.size() < (count + 1) / 2) {
+      this->uplink_encoded_.resize((count + 1) / 2);
+    }
+    audio_size = this->uplink_ulaw_.encode(samples, count, this->uplink_encoded_.data());
+    audio_bytes = this->uplink_encoded_.data();
+  }
+
+  // Encode straight into the outgoing user_audio_chunk frame; see uplink_frame_writer.h.
+  size_t frame_len = this->uplink_frame_.build(audio_bytes, audio_size);
+
+  ESP_LOGV(TAG, "UPLINK: Encoded %zu mono samples (%zu bytes of %s) into a %zu byte frame", 
+           count, audio_size, uplink_format_name(this->uplink_active_format_.load()), frame_len);
+
+  // Bounded: a stalled socket costs this frame, and the backlog behind it is trimmed,
+  // but nothing upstream ever waits on it.
+  uint32_t started_us = micros();
+  bool sent = this->client_ != nullptr &&
+              this->client_->send_message(this->uplink_frame_.data(), frame_len,
+                                          pdMS_TO_TICKS(this->uplink_send_timeout_ms_));
+  uint32_t elapsed_us = micros() - started_us;
+  this->uplink_send_latency_.record(elapsed_us);
+  this->uplink_send_us_ += elapsed_us;
+  if (!sent) {
+    bool timed_out = elapsed_us >= this->uplink_send_timeout_ms_ * 1000;
+    (timed_out ? this->uplink_send_timeouts_ : this->uplink_send_failures_)++;
+    ESP_LOGW(TAG, "UPLINK: %s sending audio frame after %" PRIu32 "ms; dropped %zu samples",
+             timed_out ? "Timed out" : "Failed", elapsed_us / 1000, count);
+    return false;
+  }
+  this->uplink_frames_++;
+  this->uplink_bytes_ += frame_len;
+  this->uplink_last_sent_ms_ = millis();
+  return true;
+}
+
+// Sends the aggregated microphone samples as user_audio_chunk frames. Runs on the uplink
+// task only, and returns how long it may sleep before the next frame is due.
+//
+// Sending one message per i2s block paid for a JSON envelope, a TLS record and a
+// websocket header every few milliseconds. Samples are collected for
+// uplink_frame_duration before they go out: a little latency in exchange for far fewer,
+// larger frames, which is what a congested link wants. A duration of 0 sends whatever
+// has arrived each time the task wakes.
+TickType_t ElevenLabsStream::service_uplink() {
+  if (this->state_ != StreamState::ON) {
+    if (this->uplink_in_conversation_) {
+      this->end_uplink_conversation();
+    }
+    // Still connecting: what is queued is the connect buffer, held until the
+    // conversation goes live.
+    if (this->starting_ && this->connect_buffer_ms_ > 0) {
+      return portMAX_DELAY;
+    }
+    // Whatever was waiting belongs to a conversation that is over.
+    this->uplink_ring_.clear();
+    this->uplink_waiting_ = false;
+    this->uplink_pending_ = 0;
+    return portMAX_DELAY;
+  }
+  if (!this->uplink_in_conversation_) {
+    this->begin_uplink_conversation();
+  }
+
+  // Keep the backlog within budget. What is over it has waited too long to be worth
+  // sending: on a weak link the agent gets recent audio with gaps, rather than audio
+  // that falls further behind with every frame. The connect buffer is the exception: it
+  // is old by design, and goes out as one burst before the budget applies again.
+  size_t backlog = this->uplink_backlog_samples();
+  if (this->uplink_sending_connect_buffer_ && this->uplink_ring_.available() <= backlog) {
+    this->uplink_sending_connect_buffer_ = false;
+  }
+  if (!this->uplink_sending_connect_buffer_) {
+    size_t trimmed = this->uplink_ring_.trim(backlog);
+    if (trimmed > 0) {
+      ESP_LOGD(TAG, "UPLINK: Backlog over budget, dropped the oldest %zu samples", trimmed);
+    }
+  }
+  if (this->uplink_vad_enabled_) {
+    return this->service_gated_uplink();
+  }
+
+  const size_t frame_samples = this->uplink_frame_duration_ms_ * UPLINK_SAMPLES_PER_MS;
+  const size_t frame_cap = std::min(frame_samples > 0 ? frame_samples : this->audio_buffer_.size(),
+                                    this->audio_buffer_.size());
+  while (true) {
+    size_t available = this->uplink_ring_.available();
+    if (available == 0) {
+      this->uplink_waiting_ = false;
+      return portMAX_DELAY;
+    }
+    uint32_t now = millis();
+    if (!this->uplink_waiting_) {
+      this->uplink_waiting_ = true;
+      this->uplink_pending_since_ms_ = now;
+    }
+    // Send once a frame's worth has built up, or once the oldest sample has waited that
+    // long -- i2s blocks do not always arrive evenly, and a short trickle must not sit in
+    // the ring indefinitely.
+    uint32_t waited = now - this->uplink_pending_since_ms_;
+    if (available < frame_samples && waited < this->uplink_frame_duration_ms_) {
+      return pdMS_TO_TICKS(this->uplink_frame_duration_ms_ - waited) + 1;
+    }
+
+    size_t count = this->uplink_ring_.pop(this->audio_buffer_.data(), std::min(available, frame_cap));
+    this->uplink_waiting_ = false;
+    if (count == 0) {
+      continue;
+    }
+    if (!this->send_uplink_frame(this->audio_buffer_.data(), count)) {
+      return UPLINK_RETRY_TICKS;
+    }
+    this->uplink_vad_sent_bytes_ += count * sizeof(int16_t);
+  }
+}
+
+// The uplink backlog budget in samples. Never less than a frame and a block, or
+// aggregation itself would trip it.
+size_t ElevenLabsStream::uplink_backlog_samples() const {
+  return std::max<size_t>(this->uplink_max_backlog_ms_ * UPLINK_SAMPLES_PER_MS,
+                          this->uplink_frame_duration_ms_ * UPLINK_SAMPLES_PER_MS + UPLINK_MIN_FRAME_SAMPLES);
+}
+
+ElevenLabsStream::UplinkMetrics ElevenLabsStream::get_uplink_metrics() const {
+  UplinkRing::Stats ring = this->uplink_ring_.get_stats();
+  UplinkMetrics metrics;
+  metrics.queued_bytes = this->uplink_ring_.available() * sizeof(int16_t);
+  metrics.queued_high_water_bytes = ring.high_water * sizeof(int16_t);
+  metrics.dropped_bytes = (ring.dropped + ring.trimmed) * sizeof(int16_t);
+  metrics.send_timeouts = this->uplink_send_timeouts_.load();
+  metrics.send_failures = this->uplink_send_failures_.load();
+  metrics.control_send_failures = this->control_send_failures_.load();
+  metrics.sends = this->uplink_send_latency_.count();
+  metrics.send_p50_us = this->uplink_send_latency_.percentile(50);
+  metrics.send_p90_us = this->uplink_send_latency_.percentile(90);
+  metrics.send_p99_us = this->uplink_send_latency_.percentile(99);
+  return metrics;
+}
+
+void ElevenLabsStream::begin_uplink_conversation() {
+  this->uplink_in_conversation_ = true;
+  this->uplink_vad_.reset();
+  this->uplink_ulaw_.reset();
+  this->uplink_pre_roll_count_ = 0;
+  this->uplink_last_sent_ms_ = millis();
+  this->uplink_vad_sent_bytes_.store(0);
+  this->uplink_vad_suppressed_bytes_.store(0);
+  this->uplink_vad_keepalives_.store(0);
+  this->uplink_vad_segments_.store(0);
+
+  // The ring holds at least the connect buffer, and may hold more if the connection was
+  // slow.
+  this->uplink_ring_.trim(this->connect_buffer_ms_ * UPLINK_SAMPLES_PER_MS);
+  size_t buffered = this->uplink_ring_.available();
+  this->uplink_sending_connect_buffer_ = buffered > 0;
+  if (buffered > 0) {
+    ESP_LOGD(TAG, "UPLINK: Sending %zums of audio buffered while connecting", buffered / UPLINK_SAMPLES_PER_MS);
+  }
+}
+
+void ElevenLabsStream::end_uplink_conversation() {
+  this->uplink_in_conversation_ = false;
+  if (!this->uplink_vad_enabled_) {
+    return;
+  }
+  UplinkVadStats stats = this->get_uplink_vad_stats();
+  uint32_t total = stats.sent_bytes + stats.suppressed_bytes;
+  ESP_LOGI(TAG, "UPLINK: Conversation sent %" PRIu32 " bytes of microphone audio in %" PRIu32
+           " speech segments, suppressed %" PRIu32 " (%" PRIu32 "%%), %" PRIu32 " keepalives",
+           stats.sent_bytes, stats.speech_segments, stats.suppressed_bytes,
+           total > 0 ? (uint32_t) ((uint64_t) stats.suppressed_bytes * 100 / total) : 0, stats.keepalive_frames);
+}
+
+ElevenLabsStream::UplinkVadStats ElevenLabsStream::get_uplink_vad_stats() const {
+  return {this->uplink_vad_sent_bytes_.load(), this->uplink_vad_suppressed_bytes_.load(),
+          this->uplink_vad_keepalives_.load(), this->uplink_vad_segments_.load()};
+}
+
+// Appends samples to the frame being aggregated in audio_buffer_, sending it whenever it
+// fills. Returns false if a send failed.
+bool ElevenLabsStream::queue_uplink_samples(const int16_t* samples, size_t count) {
+  while (count > 0) {
+    if (this->uplink_pending_ == 0) {
+      this->uplink_pending_since_ms_ = millis();
+    }
+    size_t n = std::min(count, this->audio_buffer_.size() - this->uplink_pending_);
+    memcpy(this->audio_buffer_.data() + this->uplink_pending_, samples, n * sizeof(int16_t));
+    this->uplink_pending_ += n;
+    samples += n;
+    count -= n;
+    if (this->uplink_pending_ == this->audio_buffer_.size() && !this->flush_uplink_samples()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ElevenLabsStream::flush_uplink_samples() {
+  size_t count = this->uplink_pending_;
+  this->uplink_pending_ = 0;
+  if (count == 0) {
+    return true;
+  }
+  if (!this->send_uplink_frame(this->audio_buffer_.data(), count)) {
+    return false;
+  }
+  this->uplink_vad_sent_bytes_ += count * sizeof(int16_t);
+  return true;
+}
+
+// The uplink with the local VAD in front of it.
+//
+// A quiet room used to cost exactly as much as a conversation: every 20ms of silence
+// was base64-encoded, wrapped, encrypted and sent. With the gate closed, windows are
+// only kept in a short pre-roll, and the agent gets a 20ms frame of digital silence
+// every keepalive_interval so the stream never looks dead. When speech starts the
+// pre-roll goes out ahead of it, so the onset the VAD needed to hear is not lost, and
+// the gate stays open through the hangover so the pause that ends a turn still reaches
+// the service's own turn detection.
+TickType_t ElevenLabsStream::service_gated_uplink() {
+  const size_t frame_samples = this->uplink_frame_duration_ms_ * UPLINK_SAMPLES_PER_MS;
+  int16_t window[UplinkVad::WINDOW_SAMPLES];
+  while (this->uplink_ring_.available() >= UplinkVad::WINDOW_SAMPLES) {
+    if (this->uplink_ring_.pop(window, UplinkVad::WINDOW_SAMPLES) != UplinkVad::WINDOW_SAMPLES) {
+      break;
+    }
+    bool was_open = this->uplink_vad_.is_open();
+    if (this->uplink_vad_.process(window)) {
+      if (!was_open) {
+        this->uplink_vad_segments_++;
+        ESP_LOGD(TAG, "UPLINK: Speech at %.1f dBFS (floor %.1f), sending %zu pre-roll windows",
+                 this->uplink_vad_.level_db(), this->uplink_vad_.noise_floor_db(), this->uplink_pre_roll_count_);
+        if (!this->release_uplink_pre_roll()) {
+          return UPLINK_RETRY_TICKS;
+        }
+      }
+      if (!this->queue_uplink_samples(window, UplinkVad::WINDOW_SAMPLES)) {
+        return UPLINK_RETRY_TICKS;
+      }
+    } else {
+      // The end of a segment goes out now rather than at the next deadline.
+      if (was_open && !this->flush_uplink_samples()) {
+        return UPLINK_RETRY_TICKS;
+      }
+      this->hold_uplink_pre_roll(window);
+      this->uplink_vad_suppressed_bytes_ += sizeof(window);
+    }
+  }
+
+  uint32_t now = millis();
+  if (this->uplink_pending_ > 0) {
+    uint32_t waited = now - this->uplink_pending_since_ms_;
+    if (this->uplink_pending_ < frame_samples && waited < this->uplink_frame_duration_ms_) {
+      return pdMS_TO_TICKS(this->uplink_frame_duration_ms_ - waited) + 1;
+    }
+    if (!this->flush_uplink_samples()) {
+      return UPLINK_RETRY_TICKS;
+    }
+  }
+  if (this->uplink_vad_.is_open()) {
+    return portMAX_DELAY;
+  }
+
+  uint32_t quiet = now - this->uplink_last_sent_ms_;
+  if (quiet >= this->uplink_keepalive_ms_) {
+    if (!this->send_uplink_frame(UPLINK_SILENCE, UplinkVad::WINDOW_SAMPLES)) {
+      return UPLINK_RETRY_TICKS;
+    }
+    this->uplink_vad_keepalives_++;
+    quiet = 0;
+  }
+  return pdMS_TO_TICKS(this->uplink_keepalive_ms_ - quiet) + 1;
+}
+
+// Keeps the most recent windows while the gate is closed, dropping the oldest.
+void ElevenLabsStream::hold_uplink_pre_roll(const int16_t* window) {
+  size_t capacity = this->uplink_pre_roll_.size() / UplinkVad::WINDOW_SAMPLES;
+  if (capacity == 0) {
+    return;
+  }
+  memcpy(this->uplink_pre_roll_.data() + this->uplink_pre_roll_next_ * UplinkVad::WINDOW_SAMPLES, window,
+         UplinkVad::WINDOW_SAMPLES * sizeof(int16_t));
+  this->uplink_pre_roll_next_ = (this->uplink_pre_roll_next_ + 1) % capacity;
+  this->uplink_pre_roll_count_ = std::min(this->uplink_pre_roll_count_ + 1, capacity);
+}
+
+// Queues the held windows, oldest first, and empties the pre-roll.
+bool ElevenLabsStream::release_uplink_pre_roll() {
+  size_t capacity = this->uplink_pre_roll_.size() / UplinkVad::WINDOW_SAMPLES;
+  size_t count = this->uplink_pre_roll_count_;
+  this->uplink_pre_roll_count_ = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t slot = (this->uplink_pre_roll_next_ + capacity - count + i) % capacity;
+    if (!this->queue_uplink_samples(this->uplink_pre_roll_.data() + slot * UplinkVad::WINDOW_SAMPLES,
+                                    UplinkVad::WINDOW_SAMPLES)) {
+      return false;
+    }
+    this->uplink_vad_suppressed_bytes_ -= UplinkVad::WINDOW_SAMPLES * sizeof(int16_t);
+  }
+  return true;
+}
+
 void ElevenLabsStream::handle_microphone_data(const std::vector<uint8_t> &data) {
   // Periodic logging to debug microphone state
   static uint32_t last_debug_log = 0;
@@ -1235,8 +2240,12 @@ void ElevenLabsStream::handle_microphone_data(const std::vector<uint8_t> &data)
     last_debug_log = millis();
   }
 
-  // Only process microphone data if stream is ON, websocket is connected, and data is present
-  if (this->state_ != StreamState::ON || !this->client_ || !this->client_->is_connected() || data.empty()) {
+  // Only process microphone data if stream is ON, websocket is connected, and data is
+  // present -- or while connecting, into the connect buffer, before there is a socket at
+  // all.
+  bool connecting = this->state_ != StreamState::ON && this->is_capturing();
+  if (!this->is_capturing() || (!connecting && (!this->client_ || !this->client_->is_connected())) ||
+      data.empty()) {
     ESP_LOGD(TAG, "HANDLE_MIC: Skipping - state=%s, client=%s, client connected=%s, data_empty=%s",
              this->state_ == StreamState::ON ? "ON" : "OFF",
              this->client_ ? "EXISTS" : "NULL",
@@ -1245,8 +2254,10 @@ void ElevenLabsStream::handle_microphone_data(const std::vector<uint8_t> &data)
     return;
   }
 
-  // Block microphone input if speaker is active or agent audio is playing
-  if (this->speaker_is_active_) {
+  // Block microphone input if speaker is active or agent audio is playing. With barge-in
+  // the microphone stays open and the XMOS echo canceller keeps the agent's own voice
+  // out of it, so the user can talk over a reply; see handle_interruption().
+  if (this->speaker_is_active_ && !this->barge_in_) {
     ESP_LOGV(TAG, "HANDLE_MIC: Microphone blocked - speaker is active (speaker_is_active_=%s)", 
              this->speaker_is_active_ ? "true" : "false");
     return;
@@ -1265,68 +2276,44 @@ void ElevenLabsStream::handle_microphone_data(const std::vector<uint8_t> &data)
     return;
   }
 
+  const uint32_t started_us = micros();
   size_t num_samples_32bit = data.size() / 4;
   const int32_t* samples_32bit = reinterpret_cast<const int32_t*>(data.data());
-  
-  // Pre-allocate or reuse buffers to avoid repeated allocations
-  std::vector<int16_t> audio_samples;
-  audio_samples.reserve(num_samples_32bit);
-  
-  // Convert 32-bit samples to 16-bit
-  for (size_t i = 0; i < num_samples_32bit; i++) {
-    int16_t sample16 = static_cast<int16_t>(samples_32bit[i] >> 16);
-    audio_samples.push_back(sample16);
-  }
-
-  // Convert stereo to mono by averaging each left/right sample pair
-  // Handle odd number of samples safely
-  std::vector<int16_t> mono_samples;
-  size_t stereo_pairs = audio_samples.size() / 2;
-  mono_samples.reserve(stereo_pairs);
-  
-  for (size_t i = 0; i < stereo_pairs; i++) {
-    int16_t left = audio_samples[i * 2];
-    int16_t right = audio_samples[i * 2 + 1];
-    
-    // Prevent overflow in addition by using int32_t for intermediate calculation
-    int32_t sum = static_cast<int32_t>(left) + static_cast<int32_t>(right);
-    int16_t mono = static_cast<int16_t>(sum / 2);
-    mono_samples.push_back(mono);
-  }
 
   // Log warning if we had odd number of samples (data loss)
-  if (audio_samples.size() % 2 != 0) {
-    ESP_LOGW(TAG, "HANDLE_MIC: Odd number of samples (%zu), last sample dropped", audio_samples.size());
+  if (num_samples_32bit % 2 != 0) {
+    ESP_LOGW(TAG, "HANDLE_MIC: Odd number of samples (%zu), last sample dropped", num_samples_32bit);
   }
 
-  // Validate we have processed samples
-  if (mono_samples.empty()) {
-    ESP_LOGW(TAG, "HANDLE_MIC: No mono samples produced from %zu input samples", audio_samples.size());
+  // Convert 32-bit stereo straight to 16-bit mono in one pass, into a buffer that is
+  // reused from block to block. This used to build a 16-bit stereo vector and then a
+  // mono one, both by push_back -- two allocations and two passes on the microphone
+  // task for every i2s block.
+  size_t stereo_pairs = num_samples_32bit / 2;
+  if (stereo_pairs == 0) {
+    ESP_LOGW(TAG, "HANDLE_MIC: No mono samples produced from %zu input samples", num_samples_32bit);
     return;
   }
-
-  // Convert audio data to bytes
-  const uint8_t* audio_bytes = reinterpret_cast<const uint8_t*>(mono_samples.data());
-  size_t audio_size = mono_samples.size() * sizeof(int16_t);
-
-  // Encode audio as base64 for WebSocket transmission
-  std::string audio_base64 = base64_encode(audio_bytes, audio_size);
-  if (audio_base64.empty()) {
-    ESP_LOGE(TAG, "HANDLE_MIC: Failed to encode %zu bytes of audio data to base64", audio_size);
-    return;
+  if (this->mic_samples_.size() < stereo_pairs) {
+    this->mic_samples_.resize(stereo_pairs);
+  }
+  // Either one channel, read in place, or the average of both; see MicrophoneChannel.
+  if (this->microphone_channel_ == MicrophoneChannel::MIX) {
+    stereo_s32_to_mono_s16(samples_32bit, stereo_pairs, this->mic_samples_.data());
+  } else {
+    size_t channel = this->microphone_channel_ == MicrophoneChannel::RIGHT ? 1 : 0;
+    stereo_s32_channel_to_mono_s16(samples_32bit, stereo_pairs, channel, this->mic_samples_.data());
   }
 
-  ESP_LOGV(TAG, "HANDLE_MIC: Encoded %zu mono samples (%zu bytes) to base64 (%zu chars)", 
-           mono_samples.size(), audio_size, audio_base64.length());
-
-  // Send as user_audio_chunk according to protocol
-  std::string message = json::build_json([&audio_base64](JsonObject root) {
-    root["user_audio_chunk"] = audio_base64;
-  });
-  
-  if (!this->send_websocket_message(message)) {
-    ESP_LOGW(TAG, "HANDLE_MIC: Failed to send audio message via websocket");
+  // Hand the block to the uplink task and return. Encoding and sending used to happen
+  // right here, so a slow socket held up the i2s task the wake word engine also reads
+  // from. The push never waits: if the sender has fallen behind, the oldest queued audio
+  // is dropped instead.
+  this->uplink_ring_.push(this->mic_samples_.data(), stereo_pairs);
+  if (this->uplink_task_ != nullptr) {
+    xTaskNotifyGive(this->uplink_task_);
   }
+  this->microphone_busy_us_ += micros() - started_us;
   // Nothing is stamped here on success. A timestamp taken at this point only records
   // that the microphone is streaming, which it does continuously from the moment the
   // socket opens -- it says nothing about whether anyone spoke. Treating it as "last
@@ -6,11 +6,22 @@
 #include "esphome/components/network/ip_address.h"
 #include "esphome/components/audio/audio.h"
 #include "elevenlabs_client.h"
+#include "base64.h"
+#include "playback_sink.h"
+#include "audio_frame_scanner.h"
+#include "control_message.h"
+#include "uplink_frame_writer.h"
+#include "uplink_ring.h"
+#include "uplink_vad.h"
+#include "uplink_codec.h"
+#include "latency_histogram.h"
+#include "jitter_estimator.h"
+#include "pcm.h"
 
 #include <esp_websocket_client.h>
 #include <esp_http_client.h>
 #include <esp_timer.h>
-#include <mbedtls/base64.h>
+#include <atomic>
 
 namespace esphome {
 
@@ -42,14 +53,107 @@ public:
   void set_api_key(const std::string &api_key) { this->api_key_ = api_key; }
   void set_microphone(microphone::Microphone *microphone) { this->microphone_ = microphone; }
   void set_elevenlabs_speaker(speaker::Speaker *speaker) { this->elevenlabs_speaker_ = speaker; }
+  // A speaker replies go to directly, bypassing elevenlabs_speaker, whenever the agent's
+  // output rate is `sample_rate`.
+  void set_passthrough_speaker(speaker::Speaker *speaker, uint32_t sample_rate) {
+    this->passthrough_speaker_ = speaker;
+    this->passthrough_sample_rate_ = sample_rate;
+  }
+  void set_request_output_format(const std::string &format) { this->request_output_format_ = format; }
   void set_activation_speaker(speaker::Speaker *speaker) { this->activation_speaker_ = speaker; }
   void set_initial_message(const std::string &message) { this->initial_message_ = message; }
+  void set_receive_slots(size_t count) { this->receive_slots_ = count; }
+  void set_receive_slot_size(size_t size) { this->receive_slot_size_ = size; }
+  void set_uplink_frame_duration(uint32_t duration_ms) { this->uplink_frame_duration_ms_ = duration_ms; }
+  void set_uplink_codec(UplinkFormat format) { this->uplink_format_ = format; }
+  void set_microphone_channel(MicrophoneChannel channel) { this->microphone_channel_ = channel; }
+  void set_barge_in(bool barge_in) { this->barge_in_ = barge_in; }
+  void set_uplink_send_timeout(uint32_t timeout_ms) { this->uplink_send_timeout_ms_ = timeout_ms; }
+  void set_control_send_timeout(uint32_t timeout_ms) { this->control_send_timeout_ms_ = timeout_ms; }
+  void set_uplink_max_backlog(uint32_t backlog_ms) { this->uplink_max_backlog_ms_ = backlog_ms; }
+  void set_connect_buffer(uint32_t buffer_ms) { this->connect_buffer_ms_ = buffer_ms; }
+  void set_playback_buffer_size(size_t size) { this->playback_buffer_size_ = size; }
+  void set_jitter_buffer(uint32_t min_ms, uint32_t max_ms) { this->jitter_.set_bounds(min_ms, max_ms); }
+  // How long each phase of the last speaker start sequence took. drain_signalled is
+  // false when the i2s drain was a fixed settle time rather than reported output.
+  enum class StartPhase : uint8_t { IDLE, CHIME, DRAIN, SPEAKER, READY };
+  struct StartSequenceStats {
+    uint32_t chime_ms;
+    uint32_t drain_ms;
+    uint32_t speaker_ms;
+    bool drain_signalled;
+  };
+  StartSequenceStats get_start_sequence_stats() const {
+    LockGuard guard(this->start_lock_);
+    return this->start_stats_;
+  }
+
+  // How replies are arriving and how much is buffered before one starts; see
+  // JitterEstimator. Counters cover the current conversation.
+  JitterEstimator::Stats get_jitter_stats() const { return this->jitter_.get_stats(); }
+
+  // Agent audio decoded and waiting for the speaker, and what the playback task has done
+  // with it. The high-water mark covers the interval since loop()'s last periodic
+  // report; the totals run from boot.
+  struct PlaybackMetrics {
+    size_t buffered_bytes;
+    size_t high_water_bytes;
+    size_t capacity_bytes;
+    uint32_t played_bytes;
+    // Time the playback task spent copying into the speaker.
+    uint32_t busy_us;
+  };
+  PlaybackMetrics get_playback_metrics() const {
+    return {this->playback_sink_.available(), this->playback_sink_.high_water(), this->playback_sink_.capacity(),
+            this->playback_bytes_.load(), this->playback_busy_us_.load()};
+  }
+
+  // How the microphone uplink is coping with the link. Byte counts are 16-bit PCM.
+  // Counters run from boot; the high-water mark and the send latency percentiles cover
+  // the interval since loop()'s last periodic report.
+  struct UplinkMetrics {
+    uint32_t queued_bytes;
+    uint32_t queued_high_water_bytes;
+    // Lost to a full ring or trimmed from an over-budget backlog.
+    uint32_t dropped_bytes;
+    uint32_t send_timeouts;
+    uint32_t send_failures;
+    uint32_t control_send_failures;
+    uint32_t sends;
+    uint32_t send_p50_us;
+    uint32_t send_p90_us;
+    uint32_t send_p99_us;
+  };
+  UplinkMetrics get_uplink_metrics() const;
+  void set_uplink_vad(float threshold_db, uint32_t hangover_ms, uint32_t pre_roll_ms, uint32_t keepalive_ms) {
+    this->uplink_vad_enabled_ = true;
+    this->uplink_vad_threshold_db_ = threshold_db;
+    this->uplink_vad_.set_threshold(threshold_db);
+    this->uplink_vad_.set_hangover(hangover_ms);
+    this->uplink_pre_roll_ms_ = pre_roll_ms;
+    this->uplink_keepalive_ms_ = keepalive_ms;
+  }
+
+  // What the uplink VAD did with the microphone audio of the current conversation, or of
+  // the last one once it has ended. Byte counts are of 16-bit PCM, before encoding.
+  struct UplinkVadStats {
+    uint32_t sent_bytes;
+    uint32_t suppressed_bytes;
+    uint32_t keepalive_frames;
+    uint32_t speech_segments;
+  };
+  UplinkVadStats get_uplink_vad_stats() const;
 
   bool start_stream();
   bool start_stream(const std::string &initial_message);
   bool start_stream(const std::string &initial_message, uint32_t timeout_ms);
   void stop_stream();
   bool is_running() const { return this->state_ == StreamState::ON; }
+  // Whether microphone blocks should be handed to handle_microphone_data(): while the
+  // conversation runs, and with a connect buffer also while it is being set up.
+  bool is_capturing() const {
+    return this->state_ == StreamState::ON || (this->starting_ && this->connect_buffer_ms_ > 0);
+  }
   StreamState get_state() const { return this->state_; }
   void handle_microphone_data(const std::vector<uint8_t> &data);
   void handle_websocket_disconnected();
@@ -75,23 +179,69 @@ public:
   // Internal methods
   void renew_signed_url_if_needed();
   bool send_websocket_message(const std::string &message);
+  bool send_websocket_message(const char *message, size_t length);
   void handle_websocket_message(const uint8_t *buffer, size_t length);
   void parse_json_message_from_buffer(uint8_t *buffer, size_t length);
+  // One handler per ElevenLabs message type, each given the fields read from the message.
+  using MessageHandler = void (ElevenLabsStream::*)(const ControlMessage &msg);
+  static MessageHandler find_message_handler(const JsonSpan &type);
+  static void log_message_verbose(const ControlMessage &msg);
+  void handle_conversation_metadata(const ControlMessage &msg);
+  void handle_audio_message(const ControlMessage &msg);
+  void handle_user_transcript(const ControlMessage &msg);
+  void handle_agent_response(const ControlMessage &msg);
+  void handle_vad_score(const ControlMessage &msg);
+  void handle_interruption(const ControlMessage &msg);
+  void handle_ping(const ControlMessage &msg);
+  void handle_mcp_connection_status(const ControlMessage &msg);
+  void handle_agent_tool_response(const ControlMessage &msg);
   void handle_error(const std::string &error_message);
   void send_conversation_init();
   void capture_and_send_audio();
   void send_ping();
   void send_audio_chunk(const std::vector<int16_t> &audio_data);
   void set_state(StreamState new_state);
-  bool decode_and_play_base64_audio(const char* base64_data);
+  void stop_capture();
+  bool decode_assembled_audio_frame(const char* base64_data, size_t base64_len);
+  bool sink_has_room_for_frame(size_t frame_len) const;
+  void begin_audio_frame();
+  bool decode_into_sink(const char* data, size_t len, bool wait_for_room);
+  bool end_audio_frame(size_t input_len);
+  bool ensure_speaker_running();
+  void flush_reply_audio();
+  void observe_message(const uint8_t* data, size_t len);
 
   std::string agent_id_;
   std::string api_key_;
   microphone::Microphone *microphone_{nullptr};
   speaker::Speaker *elevenlabs_speaker_{nullptr};
+  speaker::Speaker *passthrough_speaker_{nullptr};
+  uint32_t passthrough_sample_rate_{0};
+  std::string request_output_format_;
+  // Whichever of the two speakers replies are played on in this conversation. Chosen by the start
+  // sequence, while the playback task is held back.
+  speaker::Speaker *reply_speaker_{nullptr};
+  void select_reply_speaker();
   speaker::Speaker *activation_speaker_{nullptr};
   ElevenLabsClient* client_ = nullptr;
+  // Websocket messages land in one of these slots while the previous one is still being
+  // handled; see WebsocketClient. Each slot must hold the largest message the agent sends.
+  size_t receive_slots_{2};
+  size_t receive_slot_size_{256 * 1024};
   StreamState state_{StreamState::OFF};
+  // Raised by stop_stream() before it disconnects, so a frame being decoded gives up at
+  // once instead of waiting for ring space that a stopping speaker will never free.
+  std::atomic<bool> stopping_{false};
+
+  // Barge-in: the microphone stays open while the agent speaks, and an interruption
+  // flushes the reply. interrupt_pending_ is raised on the websocket task as soon as the
+  // interruption is seen and cleared once it has been handled; until a frame newer than
+  // interrupted_event_id_ arrives, audio is parsed whole so stale frames can be dropped.
+  bool barge_in_{false};
+  std::atomic<bool> interrupt_pending_{false};
+  std::atomic<uint32_t> interrupt_spotted_ms_{0};
+  bool discarding_stale_audio_{false};
+  uint32_t interrupted_event_id_{0};
 
   // Protocol state members for ElevenLabs API
   std::string conversation_id_;
@@ -138,6 +288,12 @@ public:
   // from the main task while the websocket's own task may still be inside the message
   // handler. That is the reboot seen when triggering announce twice in a row.
   bool starting_{false};
+  void begin_conversation();
+  // Microphone audio captured from the wake word on, sent once the conversation is live.
+  // conversation_ready_ is raised by the agent's metadata on the websocket consumer task
+  // and taken by loop().
+  uint32_t connect_buffer_ms_{2000};
+  std::atomic<bool> conversation_ready_{false};
 
   // Set when the agent invokes the end_call system tool. The stream is not torn down on
   // the spot: end_call is usually preceded by a goodbye, and the tool response arrives
@@ -157,22 +313,162 @@ public:
   std::vector<Trigger<> *> on_replying_triggers_;
 
   // Audio buffering
+  // Mono samples of the microphone block being queued; grows to the largest block once.
+  // Microphone task only.
+  std::vector<int16_t> mic_samples_;
+  MicrophoneChannel microphone_channel_{MicrophoneChannel::MIX};
+  // Microphone audio on its way from the microphone task to the uplink task.
+  UplinkRing uplink_ring_;
+  TaskHandle_t uplink_task_{nullptr};
+  static void uplink_task(void* arg);
+  TickType_t service_uplink();
+  TickType_t service_gated_uplink();
+  bool send_uplink_frame(const int16_t* samples, size_t count);
+  bool queue_uplink_samples(const int16_t* samples, size_t count);
+  bool flush_uplink_samples();
+  void hold_uplink_pre_roll(const int16_t* window);
+  bool release_uplink_pre_roll();
+  void begin_uplink_conversation();
+  size_t uplink_backlog_samples() const;
+  void end_uplink_conversation();
+  // The rest is the uplink task's own: the samples of the frame being sent, the
+  // user_audio_chunk frame they are encoded into, and when the oldest waiting sample
+  // was first seen.
   std::vector<int16_t> audio_buffer_;
+  UplinkFrameWriter uplink_frame_;
+  uint32_t uplink_frame_duration_ms_{100};
+  bool uplink_waiting_{false};
+  // The format configured in YAML, and the one in use for this conversation: the
+  // agent's user_input_audio_format once its metadata has arrived.
+  UplinkFormat uplink_format_{UplinkFormat::PCM_16000};
+  std::atomic<UplinkFormat> uplink_active_format_{UplinkFormat::PCM_16000};
+  UlawEncoder uplink_ulaw_;
+  std::vector<uint8_t> uplink_encoded_;
+  // Samples at the front of audio_buffer_ waiting to be sent; the gated path only.
+  size_t uplink_pending_{0};
+  uint32_t uplink_last_sent_ms_{0};
+  bool uplink_in_conversation_{false};
+  // Set while the connect buffer goes out in a burst, which the backlog budget leaves
+  // alone.
+  bool uplink_sending_connect_buffer_{false};
+  // Optional local VAD in front of the uplink; see service_gated_uplink(). The pre-roll
+  // holds the most recent 20ms windows while the gate is closed.
+  bool uplink_vad_enabled_{false};
+  float uplink_vad_threshold_db_{-50.0f};
+  uint32_t uplink_pre_roll_ms_{300};
+  uint32_t uplink_keepalive_ms_{1000};
+  UplinkVad uplink_vad_;
+  std::vector<int16_t> uplink_pre_roll_;
+  size_t uplink_pre_roll_next_{0};
+  size_t uplink_pre_roll_count_{0};
+  std::atomic<uint32_t> uplink_vad_sent_bytes_{0};
+  std::atomic<uint32_t> uplink_vad_suppressed_bytes_{0};
+  std::atomic<uint32_t> uplink_vad_keepalives_{0};
+  std::atomic<uint32_t> uplink_vad_segments_{0};
+  uint32_t uplink_pending_since_ms_{0};
+  // Send bounds. Audio older than the backlog budget is dropped rather than sent late.
+  uint32_t uplink_send_timeout_ms_{1000};
+  uint32_t control_send_timeout_ms_{5000};
+  uint32_t uplink_max_backlog_ms_{500};
+  LatencyHistogram uplink_send_latency_;
+  // Running totals from both tasks, turned into rates by loop().
+  std::atomic<uint32_t> uplink_send_timeouts_{0};
+  std::atomic<uint32_t> uplink_send_failures_{0};
+  std::atomic<uint32_t> control_send_failures_{0};
+  std::atomic<uint32_t> uplink_frames_{0};
+  std::atomic<uint32_t> uplink_bytes_{0};
+  // Time spent in on_microphone_data() and in service_uplink(), and how much of the
+  // latter went on waiting for send_message() rather than encoding.
+  std::atomic<uint32_t> microphone_busy_us_{0};
+  std::atomic<uint32_t> uplink_busy_us_{0};
+  std::atomic<uint32_t> uplink_send_us_{0};
+  struct UplinkTotals {
+    uint32_t frames;
+    uint32_t bytes;
+    uint32_t microphone_busy_us;
+    uint32_t busy_us;
+    uint32_t send_us;
+  };
+  UplinkTotals uplink_report_{0, 0, 0, 0, 0};
   std::vector<uint8_t> response_audio_buffer_;
-  
-  // WebSocket message fragmentation handling
-  WebsocketMessageAssembler reassembler_;
+
+  // Decodes every agent audio frame straight into playback_sink_. See base64.h.
+  Base64Decoder audio_decoder_;
+  // PCM ring between the decoder and the speaker, allocated once in setup(). It also
+  // holds the reply prebuffer: while prebuffering, it is simply not drained.
+  PlaybackSink playback_sink_;
+  // Takes audio frames off the websocket as they arrive and feeds them to audio_decoder_.
+  AudioFrameScanner audio_scanner_;
+  // Documents for the full JSON parses the control message reader declines; see json.h.
+  JsonDocumentPool json_pool_;
+  // {"type":"pong","event_id": written once; handle_ping() appends the id and brace.
+  char pong_message_[48];
   
   // Timing and configuration constants
   uint32_t last_audio_time_{0};
 
-  // Prebuffer for the opening of each reply. Decoded audio is accumulated here until
-  // there is enough of a cushion to start playback, then written in one go. Without it
-  // the first fragment plays into a pipeline that has not settled, and the opening word
-  // arrives chopped, gapped or doubled depending on the timing.
-  std::vector<uint8_t> reply_prebuffer_;
-  bool reply_prebuffering_{true};
+  // Prebuffer for the opening of each reply. Decoded audio is held in playback_sink_
+  // until there is enough of a cushion to start playback, then written in one go.
+  // Without it the first fragment plays into a pipeline that has not settled, and the
+  // opening word arrives chopped, gapped or doubled depending on the timing. Cleared by
+  // the receive side, read by the playback task.
+  std::atomic<bool> reply_prebuffering_{true};
   uint32_t reply_prebuffer_started_ms_{0};
+  size_t playback_buffer_size_{128 * 1024};
+  // Feeds playback_sink_ to the speaker, so the receive side never waits on it.
+  TaskHandle_t playback_task_{nullptr};
+  static void playback_task(void* arg);
+  TickType_t service_playback();
+  void wake_playback();
+  // The speaker start sequence, begun once the agent's metadata is in and advanced by
+  // the events below from whichever task they arrive on; see request_start_sequence().
+  // The playback task holds back until it is done.
+  enum class StartEvent : uint8_t { ENTERED, CHIME_OUTPUT, SPEAKER_STARTED, DEADLINE };
+  void request_start_sequence();
+  void notify_start_sequence(StartEvent event);
+  void check_start_sequence_deadline();
+  void advance_start_sequence(StartEvent event, uint32_t now);
+  void enter_start_phase(StartPhase phase, uint32_t now);
+  // Guards everything the start sequence keeps, below.
+  mutable Mutex start_lock_;
+  StartPhase start_phase_{StartPhase::IDLE};
+  uint32_t start_phase_began_ms_{0};
+  // When loop() ends the current phase if its event has not come.
+  uint32_t start_phase_deadline_ms_{0};
+  uint32_t start_sequence_began_ms_{0};
+  StartSequenceStats start_stats_{};
+  std::atomic<bool> playback_ready_{false};
+  // When the activation speaker's last reported output is played, on the esp_timer
+  // clock, and whether it has ever reported any.
+  std::atomic<uint32_t> chime_output_ms_{0};
+  std::atomic<bool> chime_output_seen_{false};
+  // Playback task only: when the speaker last took nothing, or 0 while it is keeping up.
+  uint32_t playback_stalled_since_ms_{0};
+  // The reply speaker is only ever started and stopped on the playback task, which may
+  // be inside play() on it at any moment. Set by flush_reply_audio() and stop_stream()
+  // to have it stopped, and by the start sequence to have it configured and started;
+  // speaker_started_ reports back once it runs.
+  std::atomic<bool> speaker_flush_requested_{false};
+  std::atomic<bool> speaker_start_requested_{false};
+  std::atomic<bool> speaker_started_{false};
+  // Playback task only: a requested start still waiting for the speaker to run, and
+  // when it last started the speaker, or 0 once it is running.
+  bool speaker_start_pending_{false};
+  uint32_t speaker_starting_since_ms_{0};
+  bool speaker_start_timed_out_{false};
+  std::atomic<uint32_t> playback_bytes_{0};
+  std::atomic<uint32_t> playback_busy_us_{0};
+  struct PlaybackTotals {
+    uint32_t bytes;
+    uint32_t busy_us;
+  };
+  PlaybackTotals playback_report_{0, 0};
+  PlaybackTotals playback_conversation_{0, 0};
+  // Sets the cushion held before each reply starts. Receive side only.
+  JitterEstimator jitter_;
+  uint32_t agent_output_sample_rate_{16000};
+  // From a reply's first frame to the start of its playback.
+  LatencyHistogram reply_start_delay_;
   uint32_t last_audio_response_time_{0};  // Track when we last received audio from agent
   uint32_t connection_timeout_{10000};  // Reduced to 10 seconds
   uint32_t connection_start_time_{0};
@@ -0,0 +1,103 @@
+// jitter_estimator.cpp
+#include "jitter_estimator.h"
+#include <algorithm>
+#include <cstdlib>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+void JitterEstimator::set_bounds(uint32_t min_ms, uint32_t max_ms) {
+  this->min_ms_ = min_ms;
+  this->max_ms_ = std::max(min_ms, max_ms);
+  this->update_target();
+}
+
+void JitterEstimator::reset_stats() {
+  this->replies_.store(0);
+  this->frames_.store(0);
+  this->underruns_.store(0);
+  this->last_lag_ms_.store(0);
+  this->realtime_percent_.store(0);
+}
+
+void JitterEstimator::begin_reply(uint32_t now_ms) {
+  this->end_reply();
+  this->in_reply_ = true;
+  this->reply_begin_ms_ = now_ms;
+  this->reply_frames_ = 0;
+  this->reply_audio_ms_ = 0;
+  this->reply_last_lag_ms_ = 0;
+  this->reply_peak_lag_ms_ = 0;
+}
+
+void JitterEstimator::add_frame(uint32_t now_ms, uint32_t audio_ms) {
+  if (!this->in_reply_) {
+    this->begin_reply(now_ms);
+  }
+  if (this->reply_frames_ == 0) {
+    this->reply_first_arrival_ms_ = now_ms;
+  }
+  // Clamped at 0: a frame that is early only adds to the cushion, and a reply
+  // streaming well ahead of real time must not read as jittery.
+  int32_t lag = std::max<int32_t>(static_cast<int32_t>(now_ms - this->reply_first_arrival_ms_) -
+                                      static_cast<int32_t>(this->reply_audio_ms_),
+                                  0);
+  if (this->reply_frames_ > 0) {
+    int32_t delta = std::abs(lag - this->reply_last_lag_ms_);
+    this->jitter_q4_ += (static_cast<int32_t>(delta * 16) - static_cast<int32_t>(this->jitter_q4_)) / 16;
+    this->jitter_ms_.store(this->jitter_q4_ / 16);
+  }
+  this->reply_last_lag_ms_ = lag;
+  this->reply_peak_lag_ms_ = std::max(this->reply_peak_lag_ms_, lag);
+  this->reply_last_arrival_ms_ = now_ms;
+  this->reply_audio_ms_ += audio_ms;
+  this->reply_frames_++;
+  this->frames_++;
+
+  // A reply running later than the cushion allows raises it straight away, for
+  // whatever of this reply is still to be buffered and for the next.
+  if (static_cast<uint32_t>(this->reply_peak_lag_ms_) > this->needed_ms_) {
+    this->needed_ms_ = this->reply_peak_lag_ms_;
+    this->update_target();
+  }
+}
+
+void JitterEstimator::end_reply() {
+  if (!this->in_reply_) {
+    return;
+  }
+  this->in_reply_ = false;
+  if (this->reply_frames_ == 0) {
+    return;
+  }
+  uint32_t peak = static_cast<uint32_t>(this->reply_peak_lag_ms_);
+  this->needed_ms_ = std::max(peak, this->needed_ms_ - this->needed_ms_ / 8);
+  this->update_target();
+
+  this->last_lag_ms_.store(peak);
+  uint32_t span_ms = this->reply_last_arrival_ms_ - this->reply_begin_ms_;
+  if (span_ms > 0) {
+    this->realtime_percent_.store(static_cast<uint32_t>(static_cast<uint64_t>(this->reply_audio_ms_) * 100 / span_ms));
+  }
+  this->replies_++;
+}
+
+void JitterEstimator::update_target() {
+  uint32_t target = std::max(this->needed_ms_, 2 * (this->jitter_q4_ / 16));
+  this->target_ms_.store(std::min(std::max(target, this->min_ms_), this->max_ms_));
+}
+
+JitterEstimator::Stats JitterEstimator::get_stats() const {
+  Stats stats;
+  stats.replies = this->replies_.load();
+  stats.frames = this->frames_.load();
+  stats.underruns = this->underruns_.load();
+  stats.jitter_ms = this->jitter_ms_.load();
+  stats.last_lag_ms = this->last_lag_ms_.load();
+  stats.target_ms = this->target_ms_.load();
+  stats.realtime_percent = this->realtime_percent_.load();
+  return stats;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,84 @@
+// jitter_estimator.h
+#pragma once
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Decides how much agent audio to hold before a reply starts playing, from how the
+// audio of earlier replies actually arrived.
+//
+// A reply whose first frame lands at t0 and then plays in real time needs frame i, which
+// starts m_i ms into the reply, by t0 + m_i. If it lands at t_i instead, it is late by
+// t_i - t0 - m_i (early counts as on time), and a cushion of the worst lateness over the
+// reply would have covered every frame of it. That figure is carried from reply to
+// reply: it rises at once when a reply needed more, and decays by an eighth per reply
+// when replies need less, so one bad reply does not tax every later one once the link
+// has recovered. The RFC 3550 interarrival jitter of the same lateness is kept
+// alongside, and the cushion never drops below twice that.
+//
+// Frames are added on the websocket consumer task only. The published figures are
+// atomic so that loop() can report them.
+class JitterEstimator {
+ public:
+  struct Stats {
+    uint32_t replies;
+    uint32_t frames;
+    // Times the speaker ran dry partway through a reply.
+    uint32_t underruns;
+    uint32_t jitter_ms;
+    // The worst lateness in the last finished reply, and the cushion the next one waits for.
+    uint32_t last_lag_ms;
+    uint32_t target_ms;
+    // Audio received per unit of wall-clock time over the last finished reply, in
+    // percent: above 100 is faster than real time.
+    uint32_t realtime_percent;
+  };
+
+  void set_bounds(uint32_t min_ms, uint32_t max_ms);
+  // Clears the counters, once per conversation. The estimate itself is kept: the link
+  // it describes usually outlives the conversation.
+  void reset_stats();
+  // The first frame of a reply has started arriving. Finishes the previous reply.
+  void begin_reply(uint32_t now_ms);
+  // A frame carrying `audio_ms` of audio has arrived in full.
+  void add_frame(uint32_t now_ms, uint32_t audio_ms);
+  void end_reply();
+  void record_underrun() { this->underruns_++; }
+
+  // How much audio to hold before starting a reply, within the bounds.
+  uint32_t target_ms() const { return this->target_ms_.load(); }
+  Stats get_stats() const;
+
+ protected:
+  void update_target();
+
+  uint32_t min_ms_{100};
+  uint32_t max_ms_{1500};
+  // The cushion carried between replies. Starts where the fixed prebuffer used to be
+  // capped, until there is a reply to learn from.
+  uint32_t needed_ms_{400};
+  // Interarrival jitter in ms, Q4.
+  uint32_t jitter_q4_{0};
+  std::atomic<uint32_t> jitter_ms_{0};
+
+  bool in_reply_{false};
+  uint32_t reply_begin_ms_{0};
+  uint32_t reply_first_arrival_ms_{0};
+  uint32_t reply_last_arrival_ms_{0};
+  uint32_t reply_frames_{0};
+  uint32_t reply_audio_ms_{0};
+  int32_t reply_last_lag_ms_{0};
+  int32_t reply_peak_lag_ms_{0};
+
+  std::atomic<uint32_t> replies_{0};
+  std::atomic<uint32_t> frames_{0};
+  std::atomic<uint32_t> underruns_{0};
+  std::atomic<uint32_t> last_lag_ms_{0};
+  std::atomic<uint32_t> realtime_percent_{0};
+  std::atomic<uint32_t> target_ms_{400};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -1,6 +1,7 @@
 
 // json.cpp
 #include "json.h"
+#include <cstring>
 #include <esp_heap_caps.h>
 #include "esphome/core/log.h"
 #include <esphome/components/json/json_util.h>
@@ -16,6 +17,198 @@ std::string JsonDeserializer::to_string(const JsonObject& obj) {
   return out;
 }
 
+// The document size parse() asks for: twice the message, with a floor for small ones.
+static size_t document_capacity_for(size_t length) {
+    return length * 2 < 4096 ? 4096 : length * 2;
+}
+
+JsonArena::~JsonArena() {
+    heap_caps_free(block_);
+}
+
+bool JsonArena::reserve(size_t capacity) {
+    heap_caps_free(block_);
+    block_ = static_cast<uint8_t*>(heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+    capacity_ = block_ != nullptr ? capacity : 0;
+    top_ = 0;
+    last_ = SIZE_MAX;
+    live_ = 0;
+    return block_ != nullptr;
+}
+
+bool JsonArena::owns(const void* ptr) const {
+    auto* p = static_cast<const uint8_t*>(ptr);
+    return block_ != nullptr && p >= block_ && p < block_ + capacity_;
+}
+
+JsonArena::Header* JsonArena::header_of(void* ptr) const {
+    return reinterpret_cast<Header*>(static_cast<uint8_t*>(ptr) - sizeof(Header));
+}
+
+void* JsonArena::overflow(size_t size) {
+    overflows_++;
+    return PSRAMAllocator().allocate(size);
+}
+
+void* JsonArena::allocate(size_t size) {
+    size_t needed = sizeof(Header) + align(size);
+    if (capacity_ - top_ < needed) {
+        return overflow(size);
+    }
+    auto* header = reinterpret_cast<Header*>(block_ + top_);
+    header->size = size;
+    header->previous = last_;
+    last_ = top_;
+    top_ += needed;
+    live_++;
+    return header + 1;
+}
+
+void JsonArena::deallocate(void* ptr) {
+    if (ptr == nullptr) {
+        return;
+    }
+    if (!owns(ptr)) {
+        heap_caps_free(ptr);
+        return;
+    }
+    Header* header = header_of(ptr);
+    if (static_cast<size_t>(reinterpret_cast<uint8_t*>(header) - block_) == last_) {
+        // The latest allocation: its space can be handed out again at once.
+        top_ = last_;
+        last_ = header->previous;
+    }
+    if (--live_ == 0) {
+        top_ = 0;
+        last_ = SIZE_MAX;
+    }
+}
+
+void* JsonArena::reallocate(void* ptr, size_t new_size) {
+    if (ptr == nullptr) {
+        return allocate(new_size);
+    }
+    if (!owns(ptr)) {
+        return PSRAMAllocator().reallocate(ptr, new_size);
+    }
+    Header* header = header_of(ptr);
+    size_t offset = reinterpret_cast<uint8_t*>(header) - block_;
+    if (offset == last_ && capacity_ - offset >= sizeof(Header) + align(new_size)) {
+        // A string still being parsed, growing or shrunk to fit: no copy.
+        header->size = new_size;
+        top_ = offset + sizeof(Header) + align(new_size);
+        return ptr;
+    }
+    if (new_size <= header->size) {
+        header->size = new_size;
+        return ptr;
+    }
+    void* moved = allocate(new_size);
+    if (moved != nullptr) {
+        memcpy(moved, ptr, header->size);
+        deallocate(ptr);
+    }
+    return moved;
+}
+
+JsonDocumentPool::Lease& JsonDocumentPool::Lease::operator=(Lease&& other) noexcept {
+    if (this != &other) {
+        release();
+        pool_ = other.pool_;
+        index_ = other.index_;
+        doc_ = other.doc_;
+        owned_ = std::move(other.owned_);
+        other.pool_ = nullptr;
+        other.doc_ = nullptr;
+    }
+    return *this;
+}
+
+void JsonDocumentPool::Lease::release() {
+    if (pool_ != nullptr && !owned_) {
+        // Now rather than on the next acquire(), so whatever an overflowing message took
+        // from the heap goes back at once and the arena starts empty.
+        pool_->slots_[index_].doc->clear();
+        pool_->slots_[index_].leased = false;
+    }
+    owned_.reset();
+    pool_ = nullptr;
+    doc_ = nullptr;
+}
+
+bool JsonDocumentPool::allocate(size_t count, size_t capacity) {
+    slots_.clear();
+    capacity_ = capacity;
+    bool complete = true;
+    for (size_t i = 0; i < count; i++) {
+        auto arena = std::make_unique<JsonArena>();
+        if (!arena->reserve(capacity)) {
+            ESP_LOGW(TAG, "pool: No %zu bytes for document %zu, leaving it out", capacity, i);
+            complete = false;
+            continue;
+        }
+        auto doc = std::make_unique<JsonDocument>(arena.get());
+        slots_.push_back(Slot{std::move(arena), std::move(doc), false});
+    }
+    ESP_LOGD(TAG, "pool: %zu documents of %zu bytes, PSRAM Free=%zuKB", slots_.size(), capacity,
+             heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024);
+    return complete;
+}
+
+JsonDocumentPool::Stats JsonDocumentPool::get_stats() const {
+    Stats stats = stats_;
+    for (const Slot& slot : slots_) {
+        stats.overflows += slot.arena->overflows();
+    }
+    return stats;
+}
+
+JsonDocumentPool::Lease JsonDocumentPool::acquire(size_t capacity) {
+    Lease lease;
+    if (capacity > capacity_ || slots_.empty()) {
+        return lease;
+    }
+    for (size_t i = 0; i < slots_.size(); i++) {
+        if (!slots_[i].leased) {
+            slots_[i].leased = true;
+            lease.pool_ = this;
+            lease.index_ = i;
+            lease.doc_ = slots_[i].doc.get();
+            stats_.hits++;
+            return lease;
+        }
+    }
+    stats_.misses++;
+    return lease;
+}
+
+JsonDocumentPool::Lease JsonDocumentPool::adopt(std::unique_ptr<PsramJsonDocument> doc) {
+    Lease lease;
+    if (doc) {
+        stats_.fallbacks++;
+        lease.pool_ = this;
+        lease.doc_ = doc.get();
+        lease.owned_ = std::move(doc);
+    }
+    return lease;
+}
+
+JsonDocumentPool::Lease JsonDeserializer::parse(uint8_t* buffer, size_t length, JsonDocumentPool& pool) {
+    JsonDocumentPool::Lease lease = pool.acquire(document_capacity_for(length));
+    if (!lease) {
+        // Too big for the pool, or all of it in use: a document of its own, with all the
+        // checks that come with that.
+        return pool.adopt(parse(buffer, length));
+    }
+    // char* (not const char*) selects ArduinoJson's zero-copy mode; see parse() below.
+    DeserializationError err = deserializeJson(*lease, (char*)buffer, length);
+    if (err != DeserializationError::Ok) {
+        ESP_LOGD(TAG, "parse: JSON deserialization into pooled document failed: %s", err.c_str());
+        return JsonDocumentPool::Lease();
+    }
+    return lease;
+}
+
 std::unique_ptr<BasicJsonDocument<PSRAMAllocator>> JsonDeserializer::parse(uint8_t* buffer, size_t length) {
     // Log PSRAM before parsing
     size_t psram_free_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
@@ -35,10 +228,7 @@ std::unique_ptr<BasicJsonDocument<PSRAMAllocator>> JsonDeserializer::parse(uint8
     // 2x covers the structural overhead with a wide margin now that the payload is not
     // duplicated, and the floor keeps small control messages from getting a pool too
     // tight to work in.
-    size_t capacity = length * 2;
-    if (capacity < 4096) {
-        capacity = 4096;
-    }
+    size_t capacity = document_capacity_for(length);
     
     // Check if we have enough contiguous memory available (with 512KB safety margin)
     size_t required_memory = capacity + (512 * 1024);
@@ -4,8 +4,10 @@
 #pragma once
 #include <esphome/components/json/json_util.h>
 #include <cstddef>
+#include <cstdint>
 #include <string>
 #include <memory>
+#include <vector>
 #include <esp_heap_caps.h>
 
 namespace esphome {
@@ -35,6 +37,127 @@ struct PSRAMAllocator {
     }
 };
 
+using PsramJsonDocument = BasicJsonDocument<PSRAMAllocator>;
+
+// Serves one JsonDocument from a single block allocated up front.
+//
+// ArduinoJson 7 dropped the fixed-capacity document: a JsonDocument allocates its slot
+// pools and every string as it parses, through its Allocator, and clear() hands all of
+// it back. Reusing a document therefore saves nothing unless the allocator behind it
+// does. This one hands out a bump-allocated block and takes it all back at once when the
+// last allocation is freed, which clear() guarantees between messages.
+//
+// A string that grows while it is parsed is always the latest allocation, so it is
+// extended in place. When the block is full the rest of the parse is served from PSRAM
+// as before; overflows() counts how often. Not thread safe: one document, one task.
+class JsonArena : public ArduinoJson::Allocator {
+public:
+    JsonArena() = default;
+    JsonArena(const JsonArena&) = delete;
+    JsonArena& operator=(const JsonArena&) = delete;
+    ~JsonArena();
+
+    // Allocates the block. Returns false if it could not be.
+    bool reserve(size_t capacity);
+    size_t capacity() const { return capacity_; }
+    // Bytes handed out from the block and not yet taken back.
+    size_t used() const { return top_; }
+    uint32_t overflows() const { return overflows_; }
+
+    void* allocate(size_t size) override;
+    void deallocate(void* ptr) override;
+    void* reallocate(void* ptr, size_t new_size) override;
+
+private:
+    // Each allocation is preceded by its size, so reallocate() knows what to copy.
+    struct Header {
+        size_t size;
+        size_t previous;  // Offset of the allocation before this one
+    };
+    static size_t align(size_t size) { return (size + alignof(Header) - 1) & ~(alignof(Header) - 1); }
+    bool owns(const void* ptr) const;
+    Header* header_of(void* ptr) const;
+    void* overflow(size_t size);
+
+    uint8_t* block_ = nullptr;
+    size_t capacity_ = 0;
+    size_t top_ = 0;
+    // Offset of the latest allocation's header, the only one that can grow in place.
+    size_t last_ = SIZE_MAX;
+    size_t live_ = 0;
+    uint32_t overflows_ = 0;
+};
+
+// A few JSON documents allocated once and reused for every message that needs a full
+// parse.
+//
+// JsonDeserializer::parse used to allocate a fresh document per message, sized from the
+// message, and free it again a moment later. That is a malloc/free pair per control
+// message, and under fragmented PSRAM a document that silently came back smaller than
+// asked for (see parse()) -- so NoMemory depended on what the heap looked like at the
+// time. Pooled documents get their memory up front, from a JsonArena each, while PSRAM is
+// still clean, and only give it back to that arena between messages.
+//
+// Messages too large for a pooled document, or arriving while every one is leased, still
+// get a document of their own; the counters show how often that happens. Not thread
+// safe: acquire and release from one task.
+class JsonDocumentPool {
+public:
+    struct Stats {
+        uint32_t hits = 0;       // Parses served from a pooled document
+        uint32_t misses = 0;     // Parses that fitted a pooled document but found none free
+        uint32_t fallbacks = 0;  // Documents allocated on demand, for misses or oversized messages
+        uint32_t overflows = 0;  // Allocations a pooled document's arena was too full to serve
+    };
+
+    // A pooled document on loan, or one allocated just for this message. Returns the
+    // document to the pool, or frees it, when destroyed.
+    class Lease {
+    public:
+        Lease() = default;
+        Lease(Lease&& other) noexcept { *this = std::move(other); }
+        Lease& operator=(Lease&& other) noexcept;
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { release(); }
+
+        explicit operator bool() const { return doc_ != nullptr; }
+        JsonDocument* operator->() const { return doc_; }
+        JsonDocument& operator*() const { return *doc_; }
+
+    private:
+        friend class JsonDocumentPool;
+        void release();
+
+        JsonDocumentPool* pool_ = nullptr;
+        size_t index_ = 0;
+        JsonDocument* doc_ = nullptr;
+        std::unique_ptr<PsramJsonDocument> owned_;
+    };
+
+    // Allocates `count` documents with an arena of `capacity` bytes each. Returns false if
+    // any arena could not be allocated; the documents that got one are kept.
+    bool allocate(size_t count, size_t capacity);
+    // A cleared document with room for `capacity` bytes, or an empty lease if every
+    // pooled document is out or too small. Counts a hit or a miss accordingly.
+    Lease acquire(size_t capacity);
+    // Wraps a document allocated on demand so it is counted and released like the rest.
+    Lease adopt(std::unique_ptr<PsramJsonDocument> doc);
+    size_t document_capacity() const { return capacity_; }
+    Stats get_stats() const;
+
+private:
+    struct Slot {
+        // Declared first so it outlives the document that allocates from it.
+        std::unique_ptr<JsonArena> arena;
+        std::unique_ptr<JsonDocument> doc;
+        bool leased = false;
+    };
+    std::vector<Slot> slots_;
+    size_t capacity_ = 0;
+    Stats stats_;
+};
+
 class JsonDeserializer {
 public:
     // Parses a JSON buffer and returns a unique_ptr to the document. Returns nullptr on error.
@@ -45,6 +168,9 @@ public:
     // The buffer is rewritten in place and must outlive the returned document.
     static std::unique_ptr<BasicJsonDocument<PSRAMAllocator>> parse(uint8_t* buffer, size_t length);
     static std::unique_ptr<BasicJsonDocument<PSRAMAllocator>> parse(const char* cstr);
+    // Same zero-copy parse, into a document leased from `pool` when the message fits one
+    // and into a document of its own otherwise. Returns an empty lease on error.
+    static JsonDocumentPool::Lease parse(uint8_t* buffer, size_t length, JsonDocumentPool& pool);
     
     // Serialize a JsonObject to a std::string
     static std::string to_string(const JsonObject& obj);
@@ -0,0 +1,64 @@
+// latency_histogram.cpp
+#include "latency_histogram.h"
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+void LatencyHistogram::record(uint32_t us) {
+  size_t bucket = us == 0 ? 0 : 31 - __builtin_clz(us);
+  if (bucket >= BUCKETS) {
+    bucket = BUCKETS - 1;
+  }
+  this->buckets_[bucket]++;
+}
+
+uint32_t LatencyHistogram::count() const {
+  uint32_t total = 0;
+  for (const auto &bucket : this->buckets_) {
+    total += bucket.load();
+  }
+  return total;
+}
+
+uint32_t LatencyHistogram::percentile(uint32_t percent) const {
+  uint32_t counts[BUCKETS];
+  uint32_t total = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    counts[i] = this->buckets_[i].load();
+    total += counts[i];
+  }
+  if (total == 0) {
+    return 0;
+  }
+  // Rank of the sample wanted, 1-based.
+  uint64_t rank = (static_cast<uint64_t>(total) * percent + 99) / 100;
+  if (rank == 0) {
+    rank = 1;
+  }
+  uint64_t seen = 0;
+  for (size_t i = 0; i < BUCKETS; i++) {
+    if (counts[i] == 0) {
+      continue;
+    }
+    if (seen + counts[i] >= rank) {
+      uint64_t low = 1ULL << i;
+      uint64_t width = low;  // [2^i, 2^(i+1))
+      if (i == 0) {
+        low = 0;
+        width = 2;
+      }
+      return static_cast<uint32_t>(low + width * (rank - seen) / counts[i]);
+    }
+    seen += counts[i];
+  }
+  return 0;
+}
+
+void LatencyHistogram::reset() {
+  for (auto &bucket : this->buckets_) {
+    bucket.store(0);
+  }
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
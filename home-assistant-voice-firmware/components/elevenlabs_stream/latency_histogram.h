@@ -0,0 +1,35 @@
+// latency_histogram.h
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Durations in microseconds, counted into power-of-two buckets.
+//
+// Bucket i holds [2^i, 2^(i+1)) us, so 24 buckets reach past 16 seconds in 96 bytes,
+// recording is a count-leading-zeros and an increment, and nothing is ever allocated.
+// Percentiles interpolate within a bucket, which is as precise as a log scale allows
+// and plenty for telling a 5ms send from a 500ms one.
+//
+// One task records while another reads and resets; every bucket is atomic, so a
+// reading taken mid-record is at most one sample off.
+class LatencyHistogram {
+ public:
+  static const size_t BUCKETS = 24;
+
+  void record(uint32_t us);
+  // The duration below which `percent` of the recorded samples fall, or 0 if nothing
+  // has been recorded.
+  uint32_t percentile(uint32_t percent) const;
+  uint32_t count() const;
+  void reset();
+
+ protected:
+  std::atomic<uint32_t> buckets_[BUCKETS]{};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,64 @@
+// pcm.cpp
+#include "pcm.h"
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Halves a sum of two 16-bit samples, rounding toward zero like integer division. Adding
+// the sign bit first turns the arithmetic shift's round-down into a round-toward-zero,
+// without a branch.
+static inline int32_t halve_toward_zero(int32_t sum) {
+  return (sum + static_cast<int32_t>(static_cast<uint32_t>(sum) >> 31)) >> 1;
+}
+
+size_t stereo_s32_to_mono_s16_reference(const int32_t *in, size_t frames, int16_t *out) {
+  for (size_t i = 0; i < frames; i++) {
+    int32_t left = static_cast<int16_t>(in[2 * i] >> 16);
+    int32_t right = static_cast<int16_t>(in[2 * i + 1] >> 16);
+    out[i] = static_cast<int16_t>((left + right) / 2);
+  }
+  return frames;
+}
+
+// Two frames per iteration, packed into one 32-bit store.
+//
+// The ESP32-S3's PIE vector unit would want 16-byte aligned blocks and hand-written
+// assembly; this is the portable version of the same idea. Both halves of a word are
+// computed in registers and written together, so the loop does four loads and one store
+// for every two output samples, with no branches in the body. Little endian only, like
+// every target this component builds for.
+size_t stereo_s32_to_mono_s16(const int32_t *in, size_t frames, int16_t *out) {
+  size_t i = 0;
+  for (; i + 2 <= frames; i += 2) {
+    const int32_t *frame = in + 2 * i;
+    int32_t first = halve_toward_zero((frame[0] >> 16) + (frame[1] >> 16));
+    int32_t second = halve_toward_zero((frame[2] >> 16) + (frame[3] >> 16));
+    uint32_t packed = (static_cast<uint32_t>(second) << 16) | (static_cast<uint32_t>(first) & 0xFFFF);
+    // memcpy rather than a cast: out is only guaranteed 2-byte aligned.
+    memcpy(out + i, &packed, sizeof(packed));
+  }
+  if (i < frames) {
+    out[i] = static_cast<int16_t>(halve_toward_zero((in[2 * i] >> 16) + (in[2 * i + 1] >> 16)));
+  }
+  return frames;
+}
+
+// The same two-at-a-time packing, over every second sample.
+size_t stereo_s32_channel_to_mono_s16(const int32_t *in, size_t frames, size_t channel, int16_t *out) {
+  const int32_t *samples = in + channel;
+  size_t i = 0;
+  for (; i + 2 <= frames; i += 2) {
+    uint32_t first = static_cast<uint32_t>(samples[2 * i]) >> 16;
+    uint32_t second = static_cast<uint32_t>(samples[2 * i + 2]) >> 16;
+    uint32_t packed = (second << 16) | first;
+    memcpy(out + i, &packed, sizeof(packed));
+  }
+  if (i < frames) {
+    out[i] = static_cast<int16_t>(samples[2 * i] >> 16);
+  }
+  return frames;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,38 @@
+// pcm.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Which of the two i2s channels becomes the mono uplink. On the Voice PE they are not
+// two microphones: the XMOS chip sends a different stage of its pipeline on each (see
+// voice_kit's channel_0_stage and channel_1_stage), so MIX averages two versions of the
+// same sound.
+enum class MicrophoneChannel : uint8_t {
+  MIX,
+  LEFT,
+  RIGHT,
+};
+
+// Converts interleaved 32-bit stereo microphone frames to 16-bit mono in one pass.
+//
+// Each output sample is the average of the top 16 bits of the left and right samples,
+// rounded toward zero -- the same result the old two-pass conversion produced through
+// a 16-bit stereo vector and a second mono vector. `out` must hold `frames` samples and
+// may not overlap `in`. Returns the number of samples written, which is `frames`.
+size_t stereo_s32_to_mono_s16(const int32_t *in, size_t frames, int16_t *out);
+
+// Takes a single channel -- 0 for left, 1 for right -- of interleaved 32-bit stereo
+// frames as 16-bit mono: the top 16 bits of every second sample, read in place. Half
+// the loads of stereo_s32_to_mono_s16() and no arithmetic beyond the shift. Same
+// contract for `out` and the return value.
+size_t stereo_s32_channel_to_mono_s16(const int32_t *in, size_t frames, size_t channel, int16_t *out);
+
+// Plain one-frame-at-a-time version of stereo_s32_to_mono_s16(), kept as the reference the unrolled
+// kernel must match bit for bit.
+size_t stereo_s32_to_mono_s16_reference(const int32_t *in, size_t frames, int16_t *out);
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
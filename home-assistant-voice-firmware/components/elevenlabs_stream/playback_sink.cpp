@@ -0,0 +1,130 @@
+// playback_sink.cpp
+#include "playback_sink.h"
+#include "esphome/core/log.h"
+#include "esphome/components/speaker/speaker.h"
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+static const char *TAG = "playback_sink";
+
+PlaybackSink::~PlaybackSink() {
+  if (this->buffer_ != nullptr) {
+    heap_caps_free(this->buffer_);
+  }
+}
+
+bool PlaybackSink::allocate(size_t capacity) {
+  if (this->buffer_ != nullptr) {
+    heap_caps_free(this->buffer_);
+    this->buffer_ = nullptr;
+    this->capacity_ = 0;
+  }
+  this->buffer_ = static_cast<uint8_t *>(heap_caps_malloc(capacity, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (this->buffer_ == nullptr) {
+    ESP_LOGW(TAG, "PSRAM allocation of %zu bytes failed, trying regular heap", capacity);
+    this->buffer_ = static_cast<uint8_t *>(heap_caps_malloc(capacity, MALLOC_CAP_8BIT));
+  }
+  if (this->buffer_ == nullptr) {
+    ESP_LOGE(TAG, "Failed to allocate %zu bytes in any heap", capacity);
+    return false;
+  }
+  this->capacity_ = capacity;
+  this->head_.store(0);
+  this->tail_.store(0);
+  this->high_water_.store(0);
+  ESP_LOGD(TAG, "Allocated %zu byte playback ring, PSRAM Free=%zuKB", capacity,
+           heap_caps_get_free_size(MALLOC_CAP_SPIRAM) / 1024);
+  return true;
+}
+
+size_t PlaybackSink::free_space() const {
+  // Read index before reading_: pump() publishes reading_ before it checks the index
+  // again, so one of the two loads sees the span it is about to play.
+  size_t tail = this->tail_.load();
+  size_t reading = this->reading_.load();
+  if (reading != NOT_READING) {
+    tail = reading;
+  }
+  size_t used = (this->head_.load() + this->wrap_size() - tail) % std::max<size_t>(this->wrap_size(), 1);
+  return this->capacity_ - used;
+}
+
+uint8_t *PlaybackSink::acquire(size_t &len) {
+  if (this->buffer_ == nullptr) {
+    len = 0;
+    return nullptr;
+  }
+  size_t pos = this->head_.load() % this->capacity_;
+  len = std::min(this->free_space(), this->capacity_ - pos);
+  return len > 0 ? this->buffer_ + pos : nullptr;
+}
+
+void PlaybackSink::commit(size_t len) {
+  this->head_.store(this->advance(this->head_.load(), len));
+  size_t fill = this->available();
+  if (fill > this->high_water_.load()) {
+    this->high_water_.store(fill);
+  }
+}
+
+size_t PlaybackSink::write(const uint8_t *data, size_t len) {
+  size_t done = 0;
+  while (done < len) {
+    size_t span_len = 0;
+    uint8_t *span = this->acquire(span_len);
+    if (span == nullptr) {
+      break;
+    }
+    size_t n = std::min(span_len, len - done);
+    memcpy(span, data + done, n);
+    this->commit(n);
+    done += n;
+  }
+  return done;
+}
+
+const uint8_t *PlaybackSink::peek(size_t &len) const { return this->span_at(this->tail_.load(), len); }
+
+const uint8_t *PlaybackSink::span_at(size_t tail, size_t &len) const {
+  if (this->buffer_ == nullptr) {
+    len = 0;
+    return nullptr;
+  }
+  size_t pos = tail % this->capacity_;
+  size_t available = (this->head_.load() + this->wrap_size() - tail) % this->wrap_size();
+  len = std::min(available, this->capacity_ - pos);
+  return len > 0 ? this->buffer_ + pos : nullptr;
+}
+
+void PlaybackSink::consume(size_t len) { this->tail_.store(this->advance(this->tail_.load(), len)); }
+
+size_t PlaybackSink::pump(TickType_t wait) {
+  if (this->speaker_ == nullptr) {
+    return 0;
+  }
+  // The span and the compare-exchange below work from this one read of the index, so a
+  // clear() landing in between cannot hand the speaker bytes from the new position.
+  // Published first, so the writer keeps off the span until the speaker has copied it;
+  // a clear() before the writer could see it is caught by reading the index again.
+  size_t tail = this->tail_.load();
+  this->reading_.store(tail);
+  for (size_t moved; (moved = this->tail_.load()) != tail;) {
+    tail = moved;
+    this->reading_.store(tail);
+  }
+  size_t span_len = 0;
+  const uint8_t *span = this->span_at(tail, span_len);
+  size_t written = span != nullptr ? this->speaker_->play(span, span_len, wait) : 0;
+  // Advance from where the span was taken. If clear() ran meanwhile, what was played
+  // belonged to the discarded audio and the cleared index stands.
+  this->tail_.compare_exchange_strong(tail, this->advance(tail, written));
+  this->reading_.store(NOT_READING);
+  return written;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
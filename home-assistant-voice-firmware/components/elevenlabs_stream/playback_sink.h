@@ -0,0 +1,96 @@
+// playback_sink.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <freertos/FreeRTOS.h>
+
+namespace esphome {
+
+namespace speaker { class Speaker; }
+
+namespace elevenlabs_stream {
+
+// PCM ring between the base64 decoder and the speaker.
+//
+// Agent audio used to be decoded into a malloc'd buffer, copied into the reply
+// prebuffer, copied again into a second malloc'd buffer on flush, and only then handed
+// to Speaker::play -- which copies it once more into the resampler's own ring. The sink
+// replaces the first three of those: the decoder asks for a writable span, decodes
+// straight into it and commits, and the speaker is fed from the readable side without
+// any intermediate buffer. The ring is allocated once and never resized, so a frame
+// costs no allocation at all.
+//
+// One writer and one reader. Each index is only ever stored by its own side, so
+// acquire/commit and peek/consume can run on different tasks without a lock. The one
+// exception is clear(), which either side may call: pump() only advances the read index
+// from the value it peeked at, so a pump racing a clear cannot undo it. Nor can the
+// writer reuse the bytes a racing pump is still copying out: pump() publishes where it
+// is reading, and the writer counts free space from there until it is done. The indices
+// run modulo twice the capacity, which tells a full ring from an empty one without
+// wasting a byte and keeps them correct for any capacity.
+class PlaybackSink {
+ public:
+  PlaybackSink() = default;
+  ~PlaybackSink();
+  PlaybackSink(const PlaybackSink &) = delete;
+  PlaybackSink &operator=(const PlaybackSink &) = delete;
+
+  void set_speaker(speaker::Speaker *speaker) { this->speaker_ = speaker; }
+  // Allocates the ring in PSRAM, falling back to internal RAM. Returns false if neither
+  // has room.
+  bool allocate(size_t capacity);
+  bool is_allocated() const { return this->buffer_ != nullptr; }
+
+  // Writable span at the write cursor: up to `len` contiguous bytes, or nullptr with len
+  // 0 when the ring is full. The span stops at the end of the ring, so it can be
+  // shorter than free_space().
+  uint8_t *acquire(size_t &len);
+  // Publishes `len` bytes written into the span returned by acquire().
+  void commit(size_t len);
+  // Copies `len` bytes in, wrapping as needed. Returns how many fitted.
+  size_t write(const uint8_t *data, size_t len);
+
+  // Readable span at the read cursor, same contiguity rule as acquire().
+  const uint8_t *peek(size_t &len) const;
+  void consume(size_t len);
+
+  // Hands as much buffered audio to the speaker as it accepts within `wait`. Returns
+  // the number of bytes it took.
+  size_t pump(TickType_t wait);
+
+  size_t available() const {
+    return (this->head_.load() + this->wrap_size() - this->tail_.load()) % std::max<size_t>(this->wrap_size(), 1);
+  }
+  // Room for the writer. While pump() is handing a span to the speaker this counts from
+  // the start of that span, even if clear() has moved the read index past it.
+  size_t free_space() const;
+  size_t capacity() const { return this->capacity_; }
+  // Most bytes buffered at once since allocate() or the last reset_high_water(). Updated
+  // by the writer on commit.
+  size_t high_water() const { return this->high_water_.load(); }
+  void reset_high_water() { this->high_water_.store(this->available()); }
+  // Drops everything buffered. Safe from either side.
+  void clear() { this->tail_.store(this->head_.load()); }
+
+ protected:
+  size_t wrap_size() const { return this->capacity_ * 2; }
+  size_t advance(size_t index, size_t len) const { return (index + len) % this->wrap_size(); }
+  // Readable span starting at read index `tail`.
+  const uint8_t *span_at(size_t tail, size_t &len) const;
+
+  static constexpr size_t NOT_READING = SIZE_MAX;
+
+  speaker::Speaker *speaker_{nullptr};
+  uint8_t *buffer_{nullptr};
+  size_t capacity_{0};
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+  // Read index of the span pump() is playing, or NOT_READING.
+  std::atomic<size_t> reading_{NOT_READING};
+  std::atomic<size_t> high_water_{0};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,97 @@
+// uplink_codec.cpp
+#include "uplink_codec.h"
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+bool parse_uplink_format(const char *name, size_t len, UplinkFormat &out) {
+  if (len == 9 && memcmp(name, "pcm_16000", 9) == 0) {
+    out = UplinkFormat::PCM_16000;
+    return true;
+  }
+  if (len == 9 && memcmp(name, "ulaw_8000", 9) == 0) {
+    out = UplinkFormat::ULAW_8000;
+    return true;
+  }
+  return false;
+}
+
+const char *uplink_format_name(UplinkFormat format) {
+  switch (format) {
+    case UplinkFormat::ULAW_8000:
+      return "ulaw_8000";
+    case UplinkFormat::PCM_16000:
+    default:
+      return "pcm_16000";
+  }
+}
+
+// Segment number for the top byte of a biased magnitude: the position of its highest
+// set bit.
+static const uint8_t ULAW_SEGMENT[256] = {
+    0, 0, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+    7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+};
+
+static const int32_t ULAW_BIAS = 0x84;
+static const int32_t ULAW_CLIP = 32635;
+
+uint8_t ulaw_encode(int16_t sample) {
+  int32_t value = sample;
+  uint8_t sign = 0;
+  if (value < 0) {
+    value = -value;
+    sign = 0x80;
+  }
+  value = std::min(value, ULAW_CLIP) + ULAW_BIAS;
+  uint8_t segment = ULAW_SEGMENT[(value >> 7) & 0xFF];
+  uint8_t mantissa = (value >> (segment + 3)) & 0x0F;
+  return ~(sign | (segment << 4) | mantissa);
+}
+
+// The non-zero taps of the half-band filter either side of the centre, at offsets 1, 3,
+// 5, ... 15. With the centre tap they sum to exactly 1.0 in Q15, so DC passes unchanged.
+static const int32_t HALF_BAND_CENTER = 16386;
+static const int32_t HALF_BAND_TAPS[8] = {10328, -3177, 1618, -893, 481, -236, 96, -26};
+
+void UlawEncoder::reset() {
+  memset(this->work_, 0, sizeof(this->work_));
+  this->skip_ = 0;
+}
+
+size_t UlawEncoder::encode(const int16_t *in, size_t count, uint8_t *out) {
+  size_t produced = 0;
+  while (count > 0) {
+    size_t n = std::min(count, CHUNK);
+    memcpy(this->work_ + HISTORY, in, n * sizeof(int16_t));
+
+    // Each output is the filter over the TAPS samples ending at `end`.
+    for (size_t end = HISTORY + this->skip_; end < HISTORY + n; end += 2) {
+      const int16_t *center = this->work_ + end - HISTORY / 2;
+      int32_t acc = HALF_BAND_CENTER * center[0] + (1 << 14);
+      for (size_t k = 0; k < 8; k++) {
+        size_t offset = 2 * k + 1;
+        acc += HALF_BAND_TAPS[k] * (center[-static_cast<ptrdiff_t>(offset)] + center[offset]);
+      }
+      int32_t sample = std::max<int32_t>(-32768, std::min<int32_t>(32767, acc >> 15));
+      out[produced++] = ulaw_encode(static_cast<int16_t>(sample));
+    }
+
+    this->skip_ = (n - this->skip_) & 1;
+    memmove(this->work_, this->work_ + n, HISTORY * sizeof(int16_t));
+    in += n;
+    count -= n;
+  }
+  return produced;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
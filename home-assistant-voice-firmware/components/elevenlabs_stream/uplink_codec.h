@@ -0,0 +1,55 @@
+// uplink_codec.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// The formats the microphone uplink can send, named as ElevenLabs names them in
+// user_input_audio_format.
+enum class UplinkFormat : uint8_t {
+  PCM_16000,
+  ULAW_8000,
+};
+
+// Maps a user_input_audio_format value to a format. Returns false for one the uplink
+// cannot produce.
+bool parse_uplink_format(const char *name, size_t len, UplinkFormat &out);
+const char *uplink_format_name(UplinkFormat format);
+
+// G.711 mu-law for one 16-bit sample. The segment comes from a 256-entry table rather
+// than a search, so it is a handful of shifts and one load.
+uint8_t ulaw_encode(int16_t sample);
+
+// Turns 16 kHz mono PCM into 8 kHz mu-law: one byte per two input samples, a quarter of
+// the PCM payload and of the base64 work behind it.
+//
+// The decimation filter is a 31-tap half-band FIR in Q15: flat to within half a dB up
+// to 3.4 kHz, the edge of telephone speech, and more than 50 dB down from 5 kHz, so
+// what folds back when every other sample is dropped is inaudible. Half of a half-band
+// filter's taps are zero and the rest are symmetric, which leaves nine multiplies per
+// output sample. The filter history and the decimation phase carry from one call to
+// the next, so blocks of any length, odd included, join up seamlessly.
+class UlawEncoder {
+ public:
+  // Clears the filter history; once per conversation.
+  void reset();
+  // Encodes `count` samples into `out`, which must hold (count + 1) / 2 bytes. Returns
+  // the number of bytes written.
+  size_t encode(const int16_t *in, size_t count, uint8_t *out);
+
+ protected:
+  static const size_t TAPS = 31;
+  static const size_t HISTORY = TAPS - 1;
+  static const size_t CHUNK = 256;
+
+  // The last HISTORY input samples, followed by room for the chunk being filtered.
+  int16_t work_[HISTORY + CHUNK]{};
+  // 1 when the next output is due one sample into the next chunk rather than on its
+  // first sample.
+  size_t skip_{0};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
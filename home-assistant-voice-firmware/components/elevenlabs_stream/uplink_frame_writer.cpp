@@ -0,0 +1,37 @@
+// uplink_frame_writer.cpp
+#include "uplink_frame_writer.h"
+#include "base64.h"
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+static const char FRAME_PREFIX[] = "{\"user_audio_chunk\":\"";
+static const size_t FRAME_PREFIX_LEN = sizeof(FRAME_PREFIX) - 1;
+static const char FRAME_SUFFIX[] = "\"}";
+static const size_t FRAME_SUFFIX_LEN = sizeof(FRAME_SUFFIX) - 1;
+
+static size_t frame_size_for(size_t pcm_len) {
+  return FRAME_PREFIX_LEN + base64_encoded_size(pcm_len) + FRAME_SUFFIX_LEN;
+}
+
+void UplinkFrameWriter::reserve(size_t pcm_len) {
+  size_t needed = frame_size_for(pcm_len);
+  if (this->buffer_.size() < needed) {
+    this->buffer_.resize(needed);
+    // The prefix never changes, so it is written once per allocation.
+    memcpy(this->buffer_.data(), FRAME_PREFIX, FRAME_PREFIX_LEN);
+  }
+}
+
+size_t UplinkFrameWriter::build(const uint8_t *pcm, size_t len) {
+  this->reserve(len);
+  char *payload = this->buffer_.data() + FRAME_PREFIX_LEN;
+  size_t encoded = base64_encode_into(pcm, len, payload);
+  memcpy(payload + encoded, FRAME_SUFFIX, FRAME_SUFFIX_LEN);
+  this->size_ = FRAME_PREFIX_LEN + encoded + FRAME_SUFFIX_LEN;
+  return this->size_;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,36 @@
+// uplink_frame_writer.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Builds {"user_audio_chunk":"<base64 PCM>"} frames in one buffer that is reused from
+// frame to frame.
+//
+// Each microphone block used to be base64-encoded into a std::string, copied into an
+// ArduinoJson document, and serialised into a second std::string before it was sent --
+// three allocations and three copies of the payload per block, on the microphone task.
+// The writer encodes the PCM straight into its place between the fixed prefix and
+// suffix. The buffer only grows when a block is bigger than any before it, so steady
+// streaming allocates nothing.
+class UplinkFrameWriter {
+ public:
+  // Builds the frame for `len` bytes of PCM. Returns its length; the frame stays valid
+  // until the next call.
+  size_t build(const uint8_t *pcm, size_t len);
+  const char *data() const { return this->buffer_.data(); }
+  size_t size() const { return this->size_; }
+  // Space for frames carrying up to `pcm_len` bytes, so the first real block does not
+  // have to allocate.
+  void reserve(size_t pcm_len);
+
+ protected:
+  std::vector<char> buffer_;
+  size_t size_{0};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,144 @@
+// uplink_ring.cpp
+#include "uplink_ring.h"
+#include "esphome/core/log.h"
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+static const char *TAG = "uplink_ring";
+
+UplinkRing::~UplinkRing() {
+  if (this->buffer_ != nullptr) {
+    heap_caps_free(this->buffer_);
+  }
+}
+
+bool UplinkRing::allocate(size_t samples) {
+  if (this->buffer_ != nullptr) {
+    heap_caps_free(this->buffer_);
+    this->buffer_ = nullptr;
+  }
+  size_t capacity = 1;
+  while (capacity < samples) {
+    capacity <<= 1;
+  }
+  size_t bytes = capacity * sizeof(int16_t);
+  this->buffer_ = static_cast<int16_t *>(heap_caps_malloc(bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT));
+  if (this->buffer_ == nullptr) {
+    ESP_LOGW(TAG, "PSRAM allocation of %zu bytes failed, trying regular heap", bytes);
+    this->buffer_ = static_cast<int16_t *>(heap_caps_malloc(bytes, MALLOC_CAP_8BIT));
+  }
+  if (this->buffer_ == nullptr) {
+    ESP_LOGE(TAG, "Failed to allocate %zu bytes in any heap", bytes);
+    return false;
+  }
+  this->mask_ = static_cast<uint32_t>(capacity - 1);
+  this->head_.store(0);
+  this->tail_.store(0);
+  this->high_water_.store(0);
+  ESP_LOGD(TAG, "Allocated %zu sample uplink ring", capacity);
+  return true;
+}
+
+void UplinkRing::copy_in(uint32_t at, const int16_t *samples, size_t count) {
+  size_t pos = at & this->mask_;
+  size_t first = std::min(count, this->capacity() - pos);
+  memcpy(this->buffer_ + pos, samples, first * sizeof(int16_t));
+  memcpy(this->buffer_, samples + first, (count - first) * sizeof(int16_t));
+}
+
+void UplinkRing::copy_out(uint32_t at, int16_t *out, size_t count) const {
+  size_t pos = at & this->mask_;
+  size_t first = std::min(count, this->capacity() - pos);
+  memcpy(out, this->buffer_ + pos, first * sizeof(int16_t));
+  memcpy(out + first, this->buffer_, (count - first) * sizeof(int16_t));
+}
+
+size_t UplinkRing::push(const int16_t *samples, size_t count) {
+  if (this->buffer_ == nullptr || count == 0) {
+    return 0;
+  }
+  size_t dropped = 0;
+  // A block larger than the whole ring keeps only its newest samples.
+  if (count > this->capacity()) {
+    dropped = count - this->capacity();
+    samples += dropped;
+    count = this->capacity();
+  }
+
+  // Move the read index past whatever has to go before writing over it. If the consumer
+  // pops in the meantime the swap fails and the shortfall is worked out again.
+  uint32_t head = this->head_.load();
+  uint32_t tail = this->tail_.load();
+  while (true) {
+    size_t free = this->capacity() - (head - tail);
+    if (count <= free) {
+      break;
+    }
+    uint32_t need = static_cast<uint32_t>(count - free);
+    if (this->tail_.compare_exchange_weak(tail, tail + need)) {
+      dropped += need;
+      tail += need;
+      break;
+    }
+  }
+
+  this->copy_in(head, samples, count);
+  this->head_.store(head + static_cast<uint32_t>(count));
+
+  this->pushed_ += static_cast<uint32_t>(count);
+  if (dropped > 0) {
+    this->dropped_ += static_cast<uint32_t>(dropped);
+  }
+  uint32_t fill = head + static_cast<uint32_t>(count) - tail;
+  if (fill > this->high_water_.load()) {
+    this->high_water_.store(fill);
+  }
+  return dropped;
+}
+
+size_t UplinkRing::pop(int16_t *out, size_t max) {
+  if (this->buffer_ == nullptr) {
+    return 0;
+  }
+  uint32_t tail = this->tail_.load();
+  while (true) {
+    size_t count = std::min<size_t>(this->head_.load() - tail, max);
+    if (count == 0) {
+      return 0;
+    }
+    this->copy_out(tail, out, count);
+    // Only keep the copy if the producer did not drop (and so possibly overwrite) any of
+    // it while it was being made. On failure `tail` holds the new position.
+    if (this->tail_.compare_exchange_strong(tail, tail + static_cast<uint32_t>(count))) {
+      return count;
+    }
+  }
+}
+
+size_t UplinkRing::trim(size_t keep) {
+  uint32_t tail = this->tail_.load();
+  while (true) {
+    size_t available = this->head_.load() - tail;
+    if (available <= keep) {
+      return 0;
+    }
+    uint32_t drop = static_cast<uint32_t>(available - keep);
+    if (this->tail_.compare_exchange_weak(tail, tail + drop)) {
+      this->trimmed_ += drop;
+      return drop;
+    }
+  }
+}
+
+void UplinkRing::clear() {
+  uint32_t tail = this->tail_.load();
+  while (!this->tail_.compare_exchange_weak(tail, this->head_.load())) {
+  }
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,91 @@
+// uplink_ring.h
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Mono microphone samples on their way from the microphone task to the uplink sender.
+//
+// The microphone callback used to encode and send each block itself, so a slow socket
+// held up the i2s task -- and the wake word engine reads the same microphone. Now the
+// callback only converts and pushes here, and the sender task takes the samples off at
+// its own pace.
+//
+// One producer and one consumer, no lock. When the ring is full the producer drops the
+// oldest samples rather than waiting: stale audio is worth less to the agent than the
+// microphone task's deadline. Dropping means the producer moves the read index too, so
+// both sides update it by compare-and-swap; a pop whose copy raced a drop fails its swap
+// and is retried from the new position. The indices run freely and the capacity is a
+// power of two, so `head - tail` is the fill level across wraparound.
+//
+// clear() and trim() only ever move the read index forward, by the same compare-and-swap,
+// so any task may call them alongside the producer and the consumer: the main task
+// clears the ring in start_stream() and stop_capture() while the uplink task pops.
+class UplinkRing {
+ public:
+  struct Stats {
+    uint32_t pushed;
+    uint32_t dropped;
+    uint32_t trimmed;
+    uint32_t high_water;
+  };
+
+  UplinkRing() = default;
+  ~UplinkRing();
+  UplinkRing(const UplinkRing &) = delete;
+  UplinkRing &operator=(const UplinkRing &) = delete;
+
+  // Allocates room for at least `samples`, rounded up to a power of two, in PSRAM with a
+  // fallback to internal RAM. Returns false if neither has room.
+  bool allocate(size_t samples);
+  bool is_allocated() const { return this->buffer_ != nullptr; }
+  size_t capacity() const { return this->buffer_ != nullptr ? this->mask_ + 1 : 0; }
+
+  // Producer side. Never blocks; makes room by dropping the oldest samples. Returns how
+  // many were dropped.
+  size_t push(const int16_t *samples, size_t count);
+
+  // Consumer side. Copies up to `max` of the oldest samples into `out` and returns how
+  // many.
+  size_t pop(int16_t *out, size_t max);
+  // Any task. Discards everything buffered.
+  void clear();
+  // Any task. Drops the oldest samples until at most `keep` are left, and returns how
+  // many went.
+  size_t trim(size_t keep);
+
+  // The read index is loaded first. It never passes the write index, so the difference
+  // cannot go negative however the other tasks move them in between; a producer dropping
+  // meanwhile can only make it overstate, up to the capacity.
+  size_t available() const {
+    uint32_t tail = this->tail_.load();
+    return std::min<size_t>(this->head_.load() - tail, this->capacity());
+  }
+
+  // Counters since allocation. The high-water mark is the fullest the ring has been since
+  // the last reset_high_water().
+  Stats get_stats() const {
+    return {this->pushed_.load(), this->dropped_.load(), this->trimmed_.load(), this->high_water_.load()};
+  }
+  void reset_high_water() { this->high_water_.store(static_cast<uint32_t>(this->available())); }
+
+ protected:
+  void copy_in(uint32_t at, const int16_t *samples, size_t count);
+  void copy_out(uint32_t at, int16_t *out, size_t count) const;
+
+  int16_t *buffer_{nullptr};
+  uint32_t mask_{0};
+  std::atomic<uint32_t> head_{0};
+  std::atomic<uint32_t> tail_{0};
+  std::atomic<uint32_t> pushed_{0};
+  std::atomic<uint32_t> dropped_{0};
+  std::atomic<uint32_t> trimmed_{0};
+  std::atomic<uint32_t> high_water_{0};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,61 @@
+// uplink_vad.cpp
+#include "uplink_vad.h"
+#include <algorithm>
+#include <cmath>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// How far above the noise floor a window must be to count as speech.
+static const float NOISE_FLOOR_MARGIN_DB = 10.0f;
+// Consecutive speech windows needed to open the gate.
+static const uint32_t ONSET_WINDOWS = 2;
+// How quickly the floor follows the level, per window. It falls at once to anything
+// quieter and rises slowly, so a word that does not open the gate barely moves it. It
+// still creeps up while the gate is open -- over some twenty seconds -- so that a noise
+// which starts and never stops cannot hold the gate open for good.
+static const float NOISE_FLOOR_RISE = 0.02f;
+static const float NOISE_FLOOR_RISE_OPEN = 0.001f;
+// Full scale for 16-bit samples, squared.
+static const float FULL_SCALE_SQUARED = 32768.0f * 32768.0f;
+
+void UplinkVad::reset() {
+  this->level_db_ = -96.0f;
+  this->floor_db_ = this->threshold_db_;
+  this->onset_ = 0;
+  this->hangover_left_ = 0;
+  this->open_ = false;
+}
+
+bool UplinkVad::process(const int16_t *samples) {
+  int64_t energy = 0;
+  for (size_t i = 0; i < WINDOW_SAMPLES; i++) {
+    int32_t s = samples[i];
+    energy += s * s;
+  }
+  float mean_square = static_cast<float>(energy) / (WINDOW_SAMPLES * FULL_SCALE_SQUARED);
+  this->level_db_ = 10.0f * log10f(mean_square + 1e-10f);
+
+  bool speech = this->level_db_ > std::max(this->threshold_db_, this->floor_db_ + NOISE_FLOOR_MARGIN_DB);
+  this->onset_ = speech ? this->onset_ + 1 : 0;
+
+  if (speech && (this->open_ || this->onset_ >= ONSET_WINDOWS)) {
+    this->open_ = true;
+    this->hangover_left_ = this->hangover_windows_;
+  } else if (this->open_ && this->hangover_left_ > 0) {
+    this->hangover_left_--;
+  } else {
+    this->open_ = false;
+  }
+
+  if (this->level_db_ < this->floor_db_) {
+    this->floor_db_ = this->level_db_;
+  } else {
+    float rise = this->open_ ? NOISE_FLOOR_RISE_OPEN : NOISE_FLOOR_RISE;
+    this->floor_db_ += (this->level_db_ - this->floor_db_) * rise;
+  }
+  return this->open_;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
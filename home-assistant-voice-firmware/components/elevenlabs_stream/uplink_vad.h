@@ -0,0 +1,48 @@
+// uplink_vad.h
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Energy-based voice activity detection for the microphone uplink.
+//
+// Audio is judged in 20ms windows. A window counts as speech when its level is above
+// both the configured threshold and a margin over the room's noise floor, which is
+// tracked while nobody is speaking so a steady fan or a humming fridge does not hold
+// the gate open. Speech has to last two windows to open the gate, which ignores single
+// clicks, and the gate stays open for the hangover after the last speech window so the
+// agent hears the pause that ends a turn.
+//
+// Deliberately simple: it only decides what is worth sending. The service runs its own
+// VAD and turn detection on whatever arrives.
+class UplinkVad {
+ public:
+  static const size_t WINDOW_SAMPLES = 320;  // 20ms at 16 kHz
+
+  void set_threshold(float threshold_db) { this->threshold_db_ = threshold_db; }
+  void set_hangover(uint32_t hangover_ms) { this->hangover_windows_ = hangover_ms / 20; }
+
+  // Back to silence, with the noise floor at the threshold. Once per conversation.
+  void reset();
+  // Classifies one window of WINDOW_SAMPLES. Returns true while the gate is open.
+  bool process(const int16_t *samples);
+
+  bool is_open() const { return this->open_; }
+  float level_db() const { return this->level_db_; }
+  float noise_floor_db() const { return this->floor_db_; }
+
+ protected:
+  float threshold_db_{-50.0f};
+  uint32_t hangover_windows_{40};
+
+  float level_db_{-96.0f};
+  float floor_db_{-50.0f};
+  uint32_t onset_{0};
+  uint32_t hangover_left_{0};
+  bool open_{false};
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,110 @@
+// websocket_assembler.cpp
+#include "websocket_assembler.h"
+#include "esphome/core/log.h"
+#include <esp_heap_caps.h>
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+WebsocketMessageAssembler::WebsocketMessageAssembler(size_t maxBytes)
+    : kMax(maxBytes)
+{
+    size_t psram_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    ESP_LOGD("websocket_assembler", "Allocating WebSocket buffer: %zu bytes, PSRAM Free=%zuKB", 
+             kMax, psram_before / 1024);
+    
+    // Try PSRAM first
+    buf_ = static_cast<uint8_t*>(heap_caps_malloc(kMax, MALLOC_CAP_SPIRAM));
+    
+    if (!buf_) {
+        // Fallback to regular heap if PSRAM fails
+        ESP_LOGW("websocket_assembler", "PSRAM allocation failed, trying regular heap");
+        buf_ = static_cast<uint8_t*>(heap_caps_malloc(kMax, MALLOC_CAP_8BIT));
+        
+        if (!buf_) {
+            ESP_LOGE("websocket_assembler", "Failed to allocate %zu bytes in any heap", kMax);
+            assert(buf_ && "WebSocket buffer allocation failed");
+        } else {
+            ESP_LOGW("websocket_assembler", "Using regular heap for WebSocket buffer");
+        }
+    }
+    
+    size_t psram_after = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    size_t psram_delta = psram_before - psram_after;
+    ESP_LOGD("websocket_assembler", "WebSocket buffer allocated, PSRAM Free=%zuKB (-%zuKB)", 
+             psram_after / 1024, psram_delta / 1024);
+}
+WebsocketMessageAssembler::~WebsocketMessageAssembler() { if (buf_) free(buf_); }
+bool WebsocketMessageAssembler::add(const esp_websocket_event_data_t* e) {
+    stats_.fragments++;
+    // The last fragment of a message is the one that reaches the end of its final frame.
+    bool last = e->fin && e->payload_offset >= 0 && e->data_len >= 0 &&
+                static_cast<size_t>(e->payload_offset) + e->data_len >= static_cast<size_t>(e->payload_len);
+    if (discarding_) {
+        if (last) discarding_ = false;
+        return false;
+    }
+    if (e->payload_offset < 0 || e->data_len < 0) return abort(last);
+    size_t offset = e->payload_offset;
+    size_t length = e->data_len;
+    if (offset + length > kMax) return abort(last);
+    memcpy(buf_ + offset, e->data_ptr, length);
+
+    if (offset <= next_) {
+        // The normal case: the fragment continues the message. An overlap with what is
+        // already here is a retransmission and only extends the cursor if it runs past it.
+        next_ = std::max(next_, offset + length);
+        absorbPending();
+    } else {
+        stats_.out_of_order++;
+        if (pendingCount_ == kMaxPending) {
+            ESP_LOGW("websocket_assembler", "More than %zu out-of-order fragments, dropping message", kMaxPending);
+            return abort(last);
+        }
+        pending_[pendingCount_++] = {offset, length};
+    }
+
+    if (total_ == npos && e->payload_len) total_ = e->payload_len;
+    if (e->fin) finSeen_ = true;
+    bool ready = this->isReady();
+    if (ready) stats_.messages++;
+    return ready;
+}
+// Folds every pending range the cursor has reached into it. Repeats until nothing
+// moves, since absorbing one range can bring the next within reach.
+void WebsocketMessageAssembler::absorbPending() {
+    bool moved = true;
+    while (moved && pendingCount_ > 0) {
+        moved = false;
+        for (size_t i = 0; i < pendingCount_; i++) {
+            if (pending_[i].offset <= next_) {
+                next_ = std::max(next_, pending_[i].offset + pending_[i].length);
+                pending_[i] = pending_[--pendingCount_];
+                moved = true;
+                break;
+            }
+        }
+    }
+}
+bool WebsocketMessageAssembler::isReady() const {
+    return finSeen_ && pendingCount_ == 0 && total_ != npos && next_ == total_;
+}
+const uint8_t* WebsocketMessageAssembler::getBuffer() const { return isReady() ? buf_ : nullptr; }
+uint8_t* WebsocketMessageAssembler::getMutableBuffer() { return isReady() ? buf_ : nullptr; }
+size_t WebsocketMessageAssembler::getSize() const { return isReady() ? total_ : 0; }
+void WebsocketMessageAssembler::reset() {
+    next_ = 0; pendingCount_ = 0; total_ = npos; finSeen_ = false; discarding_ = false;
+}
+bool WebsocketMessageAssembler::abort(bool fin) {
+    stats_.dropped++;
+    reset();
+    discarding_ = !fin;
+    return false;
+}
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
@@ -0,0 +1,70 @@
+// websocket_assembler.h
+#pragma once
+#include <esp_websocket_client.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace elevenlabs_stream {
+
+// Counters for the receive path, so fragmentation and slot pressure can be measured on a
+// real link. The assembler fills in the first four; the client adds the slot counters.
+struct ReceiveStats {
+    uint32_t fragments = 0;     // Data events received
+    uint32_t messages = 0;      // Complete messages handed on
+    uint32_t out_of_order = 0;  // Fragments that did not land on the append cursor
+    uint32_t dropped = 0;       // Messages abandoned: too large, or too scattered to track
+    uint32_t slot_waits = 0;    // Messages that had to wait for the consumer to free a slot
+    uint32_t slot_overruns = 0; // Messages dropped because no slot freed up in time
+    uint32_t streamed = 0;      // Messages taken fragment by fragment by the stream handler
+};
+
+// Puts one message back together from the data events esp_websocket_client delivers
+// for it, in a buffer allocated once. Used by a single task at a time.
+class WebsocketMessageAssembler {
+    static constexpr size_t npos = SIZE_MAX;
+public:
+    // Out-of-order ranges tracked at once. esp_websocket_client delivers a message's
+    // fragments in order, so this is a safety net rather than a working set.
+    static constexpr size_t kMaxPending = 8;
+
+    explicit WebsocketMessageAssembler(size_t maxBytes = 256*1024);
+    ~WebsocketMessageAssembler();
+
+    bool add(const esp_websocket_event_data_t* e);
+    bool isReady() const;
+    const uint8_t* getBuffer() const;
+    // Non-const view for zero-copy JSON parsing, which rewrites the buffer in place.
+    // Safe: the assembler owns this memory and resets it after each message.
+    uint8_t* getMutableBuffer();
+    size_t getSize() const;
+    // Readies the assembler for a new message, including one that follows a message
+    // abandoned partway.
+    void reset();
+    const ReceiveStats& getStats() const { return stats_; }
+private:
+    struct Range {
+        size_t offset;
+        size_t length;
+    };
+    void absorbPending();
+    bool abort(bool fin);
+    const size_t kMax;
+    uint8_t* buf_;
+    // Everything below next_ has arrived. Fragments normally land exactly here, which
+    // makes completion an O(1) comparison instead of a walk over every range seen.
+    size_t next_ = 0;
+    // Fragments that arrived ahead of the cursor, in a fixed array so that no fragment
+    // costs a heap allocation.
+    Range pending_[kMaxPending];
+    size_t pendingCount_ = 0;
+    size_t total_ = npos;
+    bool finSeen_ = false;
+    // Set when a message is abandoned partway: its remaining fragments are skipped until
+    // its final one, so they cannot be mistaken for the start of the next message.
+    bool discarding_ = false;
+    ReceiveStats stats_;
+};
+
+}  // namespace elevenlabs_stream
+}  // namespace esphome
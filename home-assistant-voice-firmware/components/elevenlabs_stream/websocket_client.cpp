@@ -1,68 +1,195 @@
 
 #include "websocket_client.h"
 #include "esphome/core/hal.h"
+#include <inttypes.h>
 
 namespace esphome {
 namespace elevenlabs_stream {
 
     static const char* TAG = "WebsocketClient";
 
-// WebsocketMessageAssembler implementation
-WebsocketMessageAssembler::WebsocketMessageAssembler(size_t maxBytes)
-    : kMax(maxBytes)
-{
-    size_t psram_before = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    ESP_LOGD("websocket_assembler", "Allocating WebSocket buffer: %zu bytes, PSRAM Free=%zuKB", 
-             kMax, psram_before / 1024);
-    
-    // Try PSRAM first
-    buf_ = static_cast<uint8_t*>(heap_caps_malloc(kMax, MALLOC_CAP_SPIRAM));
-    
-    if (!buf_) {
-        // Fallback to regular heap if PSRAM fails
-        ESP_LOGW("websocket_assembler", "PSRAM allocation failed, trying regular heap");
-        buf_ = static_cast<uint8_t*>(heap_caps_malloc(kMax, MALLOC_CAP_8BIT));
-        
-        if (!buf_) {
-            ESP_LOGE("websocket_assembler", "Failed to allocate %zu bytes in any heap", kMax);
-            assert(buf_ && "WebSocket buffer allocation failed");
-        } else {
-            ESP_LOGW("websocket_assembler", "Using regular heap for WebSocket buffer");
+// WebsocketClient implementation
+
+// How long the websocket task waits for the consumer to hand a slot back before it
+// gives up on the incoming message. Long enough to ride out a speaker stall, short
+// enough that pings are not starved for good.
+static const uint32_t SLOT_WAIT_MS = 5000;
+static const uint32_t CONSUMER_TASK_STACK = 8192;
+static const UBaseType_t CONSUMER_TASK_PRIORITY = 1;
+
+WebsocketClient::WebsocketClient() {}
+WebsocketClient::~WebsocketClient() {
+    disconnect();
+    if (consumer_task_) {
+        // Wake the consumer with a stop ticket and wait for it to let go of the lock.
+        SlotTicket stop{kStopSlot, 0};
+        xQueueSend(ready_slots_, &stop, portMAX_DELAY);
+        xSemaphoreTake(consumer_lock_, portMAX_DELAY);
+        consumer_task_ = nullptr;
+    }
+    if (free_slots_) vQueueDelete(free_slots_);
+    if (ready_slots_) vQueueDelete(ready_slots_);
+    if (consumer_lock_) vSemaphoreDelete(consumer_lock_);
+}
+
+void WebsocketClient::set_receive_slots(size_t count, size_t slot_size) {
+    if (websocket_client_ || consumer_task_) {
+        ESP_LOGW(TAG, "Receive slots can only be changed before the first connection");
+        return;
+    }
+    slot_count_ = std::max<size_t>(1, std::min<size_t>(count, kStopSlot - 1));
+    slot_size_ = slot_size;
+    slots_.clear();
+    ensure_receive_pipeline();
+}
+
+// Allocates the slots, queues and consumer task on first use. Everything lives for the
+// lifetime of the client; connections only recycle the slots.
+bool WebsocketClient::ensure_receive_pipeline() {
+    if (consumer_task_) return true;
+    if (slots_.size() != slot_count_) {
+        slots_.clear();
+        for (size_t i = 0; i < slot_count_; i++) {
+            slots_.emplace_back(new WebsocketMessageAssembler(slot_size_));
         }
+        ESP_LOGI(TAG, "Allocated %zu receive slots of %zu KB", slot_count_, slot_size_ / 1024);
     }
-    
-    size_t psram_after = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
-    size_t psram_delta = psram_before - psram_after;
-    ESP_LOGD("websocket_assembler", "WebSocket buffer allocated, PSRAM Free=%zuKB (-%zuKB)", 
-             psram_after / 1024, psram_delta / 1024);
+    if (!free_slots_) free_slots_ = xQueueCreate(slot_count_, sizeof(SlotTicket));
+    // One extra entry so the stop ticket always fits.
+    if (!ready_slots_) ready_slots_ = xQueueCreate(slot_count_ + 1, sizeof(SlotTicket));
+    if (!consumer_lock_) consumer_lock_ = xSemaphoreCreateMutex();
+    if (!free_slots_ || !ready_slots_ || !consumer_lock_) {
+        ESP_LOGE(TAG, "Failed to create receive queues");
+        return false;
+    }
+    recycle_slots();
+    if (xTaskCreate(&WebsocketClient::consumer_task, "ws_consumer", CONSUMER_TASK_STACK, this,
+                    CONSUMER_TASK_PRIORITY, &consumer_task_) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start receive consumer task");
+        consumer_task_ = nullptr;
+        return false;
+    }
+    return true;
 }
-WebsocketMessageAssembler::~WebsocketMessageAssembler() { if (buf_) free(buf_); }
-bool WebsocketMessageAssembler::add(const esp_websocket_event_data_t* e) {
-    if (e->payload_offset + e->data_len > kMax) return abort();
-    memcpy(buf_ + e->payload_offset, e->data_ptr, e->data_len);
-    ranges_[e->payload_offset] = e->data_len;
-    if (total_ == npos && e->payload_len) total_ = e->payload_len;
-    if (e->fin) finSeen_ = true;
-    return this->isReady();
+
+// Returns every slot to the free queue and invalidates anything still queued for the
+// consumer. Only called while neither the websocket task nor on_message_ is running.
+void WebsocketClient::recycle_slots() {
+    uint8_t generation = generation_.fetch_add(1) + 1;
+    xQueueReset(free_slots_);
+    xQueueReset(ready_slots_);
+    for (size_t i = 0; i < slots_.size(); i++) {
+        slots_[i]->reset();
+        SlotTicket ticket{static_cast<uint8_t>(i), generation};
+        xQueueSend(free_slots_, &ticket, 0);
+    }
+    filling_ = -1;
+    skipping_ = false;
+    in_flight_.store(0);
 }
-bool WebsocketMessageAssembler::isReady() const { return finSeen_ && isContiguous(); }
-const uint8_t* WebsocketMessageAssembler::getBuffer() const { return isReady() ? buf_ : nullptr; }
-uint8_t* WebsocketMessageAssembler::getMutableBuffer() { return isReady() ? buf_ : nullptr; }
-size_t WebsocketMessageAssembler::getSize() const { return isReady() ? total_ : 0; }
-void WebsocketMessageAssembler::reset() { ranges_.clear(); total_ = npos; finSeen_ = false; }
-bool WebsocketMessageAssembler::isContiguous() const {
-    size_t next = 0;
-    for (auto& [off, len] : ranges_) {
-        if (off != next) return false;
-        next += len;
-    }
-    return total_ != npos && next == total_;
+
+void WebsocketClient::consumer_task(void* arg) {
+    WebsocketClient* client = static_cast<WebsocketClient*>(arg);
+    SlotTicket ticket;
+    while (true) {
+        if (xQueueReceive(client->ready_slots_, &ticket, portMAX_DELAY) != pdTRUE) continue;
+        xSemaphoreTake(client->consumer_lock_, portMAX_DELAY);
+        if (ticket.slot == kStopSlot) {
+            xSemaphoreGive(client->consumer_lock_);
+            vTaskDelete(nullptr);
+            return;
+        }
+        // A ticket from before the last disconnect: its slot has already been recycled.
+        if (ticket.generation == client->generation_.load()) {
+            WebsocketMessageAssembler& slot = *client->slots_[ticket.slot];
+            if (client->on_message_) {
+                client->on_message_(slot.getMutableBuffer(), slot.getSize());
+            }
+            slot.reset();
+            client->in_flight_--;
+            xQueueSend(client->free_slots_, &ticket, 0);
+        }
+        xSemaphoreGive(client->consumer_lock_);
+    }
+}
+
+// Runs on the websocket task for every text, binary or continuation fragment.
+void WebsocketClient::handle_data(const esp_websocket_event_data_t* data) {
+    bool last = data->fin && data->payload_offset >= 0 && data->data_len >= 0 &&
+                data->payload_offset + data->data_len >= data->payload_len;
+    if (skipping_) {
+        if (last) skipping_ = false;
+        return;
+    }
+    if (handle_stream_data(data, last)) {
+        return;
+    }
+    if (filling_ < 0) {
+        SlotTicket ticket;
+        if (xQueueReceive(free_slots_, &ticket, 0) != pdTRUE) {
+            slot_waits_++;
+            if (xQueueReceive(free_slots_, &ticket, pdMS_TO_TICKS(SLOT_WAIT_MS)) != pdTRUE) {
+                slot_overruns_++;
+                ESP_LOGW(TAG, "No free receive slot after %" PRIu32 "ms, dropping message", SLOT_WAIT_MS);
+                skipping_ = !last;
+                return;
+            }
+        }
+        filling_ = ticket.slot;
+    }
+    if (slots_[filling_]->add(data)) {
+        if (message_observer_) {
+            message_observer_(slots_[filling_]->getMutableBuffer(), slots_[filling_]->getSize());
+        }
+        SlotTicket ticket{static_cast<uint8_t>(filling_), generation_.load()};
+        filling_ = -1;
+        in_flight_++;
+        xQueueSend(ready_slots_, &ticket, 0);
+    }
+}
+
+// Gives the stream handler the first say on a new message and feeds it the rest of a
+// message it has taken. Returns true if the fragment was dealt with here.
+bool WebsocketClient::handle_stream_data(const esp_websocket_event_data_t* data, bool last) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(data->data_ptr);
+    if (!streaming_) {
+        // Only at the very start of a message, and only with the consumer idle.
+        if (!stream_handler_ || filling_ >= 0 || data->op_code == 0x00 || data->payload_offset != 0 ||
+            data->data_len <= 0 || in_flight_.load() != 0) {
+            return false;
+        }
+        // The frame header gives the size of the message only when the message is a
+        // single frame; a fragmented one continues in frames of its own.
+        size_t total_len = data->fin && data->payload_len > 0 ? static_cast<size_t>(data->payload_len) : 0;
+        if (!stream_handler_->on_stream_begin(bytes, data->data_len, total_len)) {
+            return false;
+        }
+        streamed_++;
+        streaming_ = true;
+        stream_next_ = data->data_len;
+    } else {
+        // A continuation frame starts its own offsets from zero.
+        if (data->op_code == 0x00 && data->payload_offset == 0) {
+            stream_next_ = 0;
+        }
+        if (data->payload_offset < 0 || static_cast<size_t>(data->payload_offset) != stream_next_) {
+            ESP_LOGW(TAG, "Streamed message skipped from offset %zu to %d, abandoning it", stream_next_,
+                     data->payload_offset);
+            streaming_ = false;
+            stream_handler_->on_stream_end(false);
+            skipping_ = !last;
+            return true;
+        }
+        stream_handler_->on_stream_data(bytes, data->data_len);
+        stream_next_ += data->data_len;
+    }
+    if (last) {
+        streaming_ = false;
+        stream_handler_->on_stream_end(true);
+    }
+    return true;
 }
-bool WebsocketMessageAssembler::abort() { reset(); return false; }
 
-// WebsocketClient implementation
-WebsocketClient::WebsocketClient() {}
-WebsocketClient::~WebsocketClient() { disconnect(); }
 bool WebsocketClient::connect(const std::string &url,
                               std::function<void(uint8_t *, size_t)> on_message,
                               std::function<void()> on_connected,
@@ -79,6 +206,9 @@ bool WebsocketClient::connect(const std::string &url,
     on_connected_ = on_connected;
     on_disconnected_ = on_disconnected;
     on_error_ = on_error;
+    if (!this->ensure_receive_pipeline()) {
+        return false;
+    }
 
     esp_websocket_client_config_t ws_cfg = {};
     ws_cfg.uri = url.c_str();
@@ -123,20 +253,35 @@ void WebsocketClient::disconnect() {
         esp_websocket_client_destroy(this->websocket_client_);
         this->websocket_client_ = nullptr;
         this->websocket_connected_ = false;
+        // The websocket task is gone, so a message it was streaming will never finish.
+        if (this->streaming_) {
+            this->streaming_ = false;
+            this->stream_handler_->on_stream_end(false);
+        }
+        // Wait out any message the consumer is still handling, then take every slot
+        // back. Must not be called from on_message_ itself.
+        if (this->consumer_lock_) {
+            xSemaphoreTake(this->consumer_lock_, portMAX_DELAY);
+            this->recycle_slots();
+            xSemaphoreGive(this->consumer_lock_);
+        }
     }
 }
 bool WebsocketClient::send_message(const std::string &message) {
-    if (!this->websocket_connected_ || !this->websocket_client_ || message.empty()) {
+    return this->send_message(message.c_str(), message.length());
+}
+bool WebsocketClient::send_message(const char *message, size_t length, TickType_t timeout) {
+    if (!this->websocket_connected_ || !this->websocket_client_ || !message || length == 0) {
         return false;
     }
-    int sent = esp_websocket_client_send_text(this->websocket_client_, message.c_str(), message.length(), portMAX_DELAY);
+    int sent = esp_websocket_client_send_text(this->websocket_client_, message, length, timeout);
     return sent >= 0;
 }
-bool WebsocketClient::send_binary(const uint8_t *data, size_t length) {
+bool WebsocketClient::send_binary(const uint8_t *data, size_t length, TickType_t timeout) {
     if (!this->websocket_connected_ || !this->websocket_client_ || !data || length == 0) {
         return false;
     }
-    int sent = esp_websocket_client_send_bin(this->websocket_client_, (const char *) data, length, portMAX_DELAY);
+    int sent = esp_websocket_client_send_bin(this->websocket_client_, (const char *) data, length, timeout);
     return sent >= 0;
 }
 bool WebsocketClient::is_connected() const { 
@@ -155,6 +300,20 @@ bool WebsocketClient::is_connected() const {
     
     return result;
 }
+ReceiveStats WebsocketClient::get_receive_stats() const {
+    ReceiveStats total;
+    for (const auto& slot : slots_) {
+        const ReceiveStats& s = slot->getStats();
+        total.fragments += s.fragments;
+        total.messages += s.messages;
+        total.out_of_order += s.out_of_order;
+        total.dropped += s.dropped;
+    }
+    total.slot_waits = slot_waits_;
+    total.slot_overruns = slot_overruns_;
+    total.streamed = streamed_;
+    return total;
+}
 void WebsocketClient::websocket_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id,
                                               void *event_data) {
     WebsocketClient *client = static_cast<WebsocketClient *>(handler_args);
@@ -193,11 +352,10 @@ void WebsocketClient::websocket_event_handler(void *handler_args, esp_event_base
                 break;
             }
 
-            if (client->reassembler_.add(data)) {
-                if (client->on_message_) {
-                    client->on_message_(client->reassembler_.getMutableBuffer(), client->reassembler_.getSize());
-                }
-                client->reassembler_.reset();
+            // Text, binary and continuation frames carry messages; ping and pong are
+            // answered by the client library and must not land in a slot.
+            if (data->op_code <= 0x02) {
+                client->handle_data(data);
             }
         }
             break;
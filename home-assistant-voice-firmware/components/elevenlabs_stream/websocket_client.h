@@ -5,47 +5,68 @@
 #include <esp_websocket_client.h>
 #include <esp_event.h>
 #include <esp_crt_bundle.h>
+#include "websocket_assembler.h"
 #include "esphome/core/log.h"
-#include <map>
 #include <vector>
+#include <memory>
+#include <atomic>
 #include <algorithm>
 #include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
 
 namespace esphome {
 namespace elevenlabs_stream {
 
 
 
-class WebsocketMessageAssembler {
-    static constexpr size_t npos = SIZE_MAX;
+// Lets a message be consumed as its fragments arrive instead of being assembled first.
+// All three calls run on the websocket task.
+class WebsocketStreamHandler {
 public:
-    explicit WebsocketMessageAssembler(size_t maxBytes = 256*1024);
-    ~WebsocketMessageAssembler();
-
-    bool add(const esp_websocket_event_data_t* e);
-    bool isReady() const;
-    const uint8_t* getBuffer() const;
-    // Non-const view for zero-copy JSON parsing, which rewrites the buffer in place.
-    // Safe: the assembler owns this memory and resets it after each message.
-    uint8_t* getMutableBuffer();
-    size_t getSize() const;
-    void reset();
-private:
-    bool isContiguous() const;
-    bool abort();
-    const size_t kMax;
-    uint8_t* buf_;
-    std::map<size_t,size_t> ranges_;
-    size_t total_ = npos;
-    bool finSeen_ = false;
+    virtual ~WebsocketStreamHandler() = default;
+    // Offered the first fragment of a message. Returning true takes the whole message:
+    // it gets the rest through on_stream_data() and never occupies a receive slot.
+    // total_len is the size of the whole message, or 0 when it is not known yet.
+    virtual bool on_stream_begin(const uint8_t* data, size_t len, size_t total_len) = 0;
+    virtual void on_stream_data(const uint8_t* data, size_t len) = 0;
+    // complete is false when the message was cut short, e.g. by a disconnect.
+    virtual void on_stream_end(bool complete) = 0;
 };
 
-
+// Receives on the websocket task and hands complete messages to a consumer task.
+//
+// on_message_ used to run on the websocket task itself, against a single assembly
+// buffer. Handling an audio frame can block on the speaker for seconds, and for all of
+// that time nothing was read from the socket: the TCP window closed, pongs went out
+// late and control events piled up behind the audio.
+//
+// Now there are several message slots. The websocket task fills a free slot, passes it
+// to the consumer task through ready_slots_ when it is complete, and carries on
+// filling the next one. The consumer hands the slot back through free_slots_ once
+// on_message_ returns. A slot belongs to exactly one side at a time, so the buffers
+// themselves need no locking.
 class WebsocketClient {
 public:
     WebsocketClient();
     ~WebsocketClient();
 
+    // Number and size of the message slots. Allocates them immediately, so it is
+    // best called once from setup(). Ignored while connected.
+    void set_receive_slots(size_t count, size_t slot_size);
+    // Offered each message before it is assembled. Only consulted while the consumer
+    // has nothing queued, so streamed and assembled messages never overtake each other.
+    void set_stream_handler(WebsocketStreamHandler* handler) { stream_handler_ = handler; }
+    // Shown every assembled message on the websocket task the moment it is complete,
+    // before it joins the queue for on_message_. For spotting the few messages that must
+    // not wait behind the ones already queued; it must be quick and must not keep the
+    // pointer.
+    void set_message_observer(std::function<void(const uint8_t*, size_t)> observer) {
+        message_observer_ = std::move(observer);
+    }
+
     bool connect(const std::string& url,
                  std::function<void(uint8_t*, size_t)> on_message,
                  std::function<void()> on_connected,
@@ -53,18 +74,63 @@ public:
                  std::function<void(const std::string&)> on_error);
     void disconnect();
     bool send_message(const std::string& message);
-    bool send_binary(const uint8_t* data, size_t length);
+    // The timeout bounds how long the send may wait for the socket; the microphone
+    // uplink must not stall behind a congested link.
+    bool send_message(const char* message, size_t length, TickType_t timeout = portMAX_DELAY);
+    bool send_binary(const uint8_t* data, size_t length, TickType_t timeout = portMAX_DELAY);
     bool is_connected() const;
+    ReceiveStats get_receive_stats() const;
 
 private:
+    // What travels through the slot queues. The generation lets a disconnect invalidate
+    // anything still queued without having to chase it down.
+    struct SlotTicket {
+        uint8_t slot;
+        uint8_t generation;
+    };
+    static constexpr uint8_t kStopSlot = 0xFF;
+
     static void websocket_event_handler(void* handler_args, esp_event_base_t base, int32_t event_id, void* event_data);
+    static void consumer_task(void* arg);
+    bool ensure_receive_pipeline();
+    void handle_data(const esp_websocket_event_data_t* data);
+    bool handle_stream_data(const esp_websocket_event_data_t* data, bool last);
+    void recycle_slots();
+
     esp_websocket_client_handle_t websocket_client_ = nullptr;
     bool websocket_connected_ = false;
     std::function<void(uint8_t*, size_t)> on_message_;
     std::function<void()> on_connected_;
     std::function<void()> on_disconnected_;
     std::function<void(const std::string&)> on_error_;
-    WebsocketMessageAssembler reassembler_{512*1024};
+
+    size_t slot_count_ = 2;
+    size_t slot_size_ = 256 * 1024;
+    std::vector<std::unique_ptr<WebsocketMessageAssembler>> slots_;
+    QueueHandle_t free_slots_ = nullptr;
+    QueueHandle_t ready_slots_ = nullptr;
+    TaskHandle_t consumer_task_ = nullptr;
+    // Held by the consumer for the duration of on_message_, so disconnect() can wait
+    // for a message in progress before recycling the slots under it.
+    SemaphoreHandle_t consumer_lock_ = nullptr;
+    std::atomic<uint8_t> generation_{0};
+    // Slot the websocket task is currently filling, or -1 between messages.
+    int filling_ = -1;
+    // Set when a message could not get a slot; its fragments are skipped up to its end.
+    bool skipping_ = false;
+    uint32_t slot_waits_ = 0;
+    uint32_t slot_overruns_ = 0;
+
+    WebsocketStreamHandler* stream_handler_ = nullptr;
+    std::function<void(const uint8_t*, size_t)> message_observer_;
+    // Messages handed to the consumer and not yet finished with. Streaming only starts
+    // at zero: the stream handler and on_message_ may share state downstream.
+    std::atomic<uint32_t> in_flight_{0};
+    // True while the stream handler owns the message being received.
+    bool streaming_ = false;
+    // Where the next fragment of the streamed frame must start.
+    size_t stream_next_ = 0;
+    uint32_t streamed_ = 0;
 };
 
 } // namespace elevenlabs_stream
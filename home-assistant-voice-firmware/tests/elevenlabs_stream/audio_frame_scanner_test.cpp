@@ -0,0 +1,97 @@
+// audio_frame_scanner_test.cpp
+#include "audio_frame_scanner.h"
+#include "test_support.h"
+#include <string>
+
+using namespace esphome::elevenlabs_stream;
+
+static const uint8_t *bytes(const std::string &s, size_t offset = 0) {
+  return reinterpret_cast<const uint8_t *>(s.data()) + offset;
+}
+
+struct Capture {
+  std::string payload;
+  size_t offered_len{0};
+  size_t ended_len{0};
+  bool ended{false};
+  bool complete{false};
+
+  void attach(AudioFrameScanner &scanner, bool accept) {
+    scanner.set_on_begin([this, accept](size_t frame_len) {
+      this->offered_len = frame_len;
+      return accept;
+    });
+    scanner.set_on_payload([this](const char *data, size_t len) {
+      this->payload.append(data, len);
+      return true;
+    });
+    scanner.set_on_end([this](size_t len, bool complete) {
+      this->ended = true;
+      this->ended_len = len;
+      this->complete = complete;
+    });
+  }
+};
+
+int main() {
+  std::string payload;
+  for (int i = 0; i < 5000; i++) {
+    payload += "ABCD"[i % 4];
+  }
+  const std::string frame =
+      "{\"audio_event\": {\"audio_base_64\" : \"" + payload + "\",\"event_id\":3},\"type\":\"audio\"}";
+
+  // The payload comes out whole however the frame is fragmented, as long as the first
+  // fragment holds the key.
+  for (size_t chunk : {40, 41, 100, 4096, 1 << 20}) {
+    AudioFrameScanner scanner;
+    Capture capture;
+    capture.attach(scanner, true);
+    size_t first = std::min(chunk, frame.size());
+    CHECK(scanner.on_stream_begin(bytes(frame), first, frame.size()));
+    CHECK(capture.offered_len == frame.size());
+    for (size_t offset = first; offset < frame.size(); offset += chunk) {
+      scanner.on_stream_data(bytes(frame, offset), std::min(chunk, frame.size() - offset));
+    }
+    scanner.on_stream_end(true);
+    CHECK(capture.ended && capture.complete);
+    CHECK(capture.payload == payload);
+    CHECK(capture.ended_len == payload.size());
+  }
+
+  // A frame cut short ends incomplete.
+  {
+    AudioFrameScanner scanner;
+    Capture capture;
+    capture.attach(scanner, true);
+    CHECK(scanner.on_stream_begin(bytes(frame), 1000, frame.size()));
+    scanner.on_stream_end(false);
+    CHECK(capture.ended && !capture.complete);
+  }
+
+  // A declined frame is left to be assembled, and nothing of it is handed on.
+  {
+    AudioFrameScanner scanner;
+    Capture capture;
+    capture.attach(scanner, false);
+    CHECK(!scanner.on_stream_begin(bytes(frame), frame.size(), frame.size()));
+    CHECK(capture.payload.empty() && !capture.ended);
+  }
+
+  // Control messages and a disabled scanner are not taken.
+  {
+    AudioFrameScanner scanner;
+    Capture capture;
+    capture.attach(scanner, true);
+    const std::string ping = "{\"type\":\"ping\",\"ping_event\":{\"event_id\":1}}";
+    CHECK(!scanner.on_stream_begin(bytes(ping), ping.size(), ping.size()));
+    scanner.set_enabled(false);
+    CHECK(!scanner.on_stream_begin(bytes(frame), frame.size(), frame.size()));
+    CHECK(capture.payload.empty());
+  }
+
+  // find_payload needs the opening quote of the value.
+  CHECK(AudioFrameScanner::find_payload("\"audio_base_64\"", 15) == -1);
+  CHECK(AudioFrameScanner::find_payload("{\"audio_base_64\":\"QUJD\"}", 24) == 18);
+  return 0;
+}
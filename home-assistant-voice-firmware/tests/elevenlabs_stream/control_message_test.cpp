@@ -0,0 +1,89 @@
+// control_message_test.cpp
+#include "control_message.h"
+#include "test_support.h"
+#include <cmath>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+// The spans in `msg` point into `text`, so these take the literals themselves rather than
+// a temporary std::string.
+static bool parse(const char *text, ControlMessage &msg) { return parse_control_message(text, strlen(text), msg); }
+
+static bool scan(const char *text, ControlMessage &msg) {
+  return scan_frequent_control_message(text, strlen(text), msg);
+}
+
+int main() {
+  ControlMessage msg;
+
+  // The fields each handler reads.
+  CHECK(parse("{\"type\":\"vad_score\",\"vad_score_event\":{\"vad_score\":0.03}}", msg));
+  CHECK(msg.type.equals("vad_score") && msg.vad_event && msg.has_vad_score);
+  CHECK(std::fabs(msg.vad_score - 0.03f) < 1e-6f);
+
+  CHECK(parse(" {\"ping_event\": {\"event_id\": 42, \"ping_ms\": null}, \"type\": \"ping\"} ", msg));
+  CHECK(msg.type.equals("ping") && msg.ping_event && msg.has_event_id && msg.event_id == 42);
+
+  CHECK(parse("{\"type\":\"conversation_initiation_metadata\",\"conversation_initiation_metadata_event\":"
+              "{\"conversation_id\":\"conv_1\",\"agent_output_audio_format\":\"pcm_16000\","
+              "\"user_input_audio_format\":\"ulaw_8000\"}}",
+              msg));
+  CHECK(msg.metadata_event && msg.conversation_id.equals("conv_1"));
+  CHECK(msg.agent_output_audio_format.equals("pcm_16000") && msg.user_input_audio_format.equals("ulaw_8000"));
+
+  CHECK(parse("{\"type\":\"interruption\",\"interruption_event\":{\"event_id\":9}}", msg));
+  CHECK(msg.interruption_event && msg.has_event_id && msg.event_id == 9);
+
+  CHECK(parse("{\"type\":\"audio\",\"audio_event\":{\"audio_base_64\":\"QUJD\",\"event_id\":3}}", msg));
+  CHECK(msg.audio_event && msg.audio_base_64.equals("QUJD") && msg.event_id == 3);
+
+  CHECK(parse("{\"type\":\"agent_tool_response\",\"agent_tool_response\":{\"tool_name\":\"end_call\","
+              "\"tool_call_id\":\"x\",\"is_error\":false,\"params\":{\"type\":\"nested\"}}}",
+              msg));
+  CHECK(msg.tool_response_event && msg.tool_name.equals("end_call") && msg.type.equals("agent_tool_response"));
+
+  // Escapes are stepped over; arrays, literals and nesting are skipped.
+  CHECK(parse("{\"type\":\"user_transcript\",\"user_transcription_event\":"
+              "{\"user_transcript\":\"He said \\\"hi\\\" \\u00e9\"}}",
+              msg));
+  CHECK(msg.transcript_event && msg.user_transcript.present());
+  CHECK(parse("{\"type\":\"x\",\"a\":[1,2.5e3,-3,{\"b\":[]},true,null]}", msg));
+
+  // Anything malformed or too deep is declined, for ArduinoJson to deal with.
+  CHECK(!parse("{\"type\":\"x\",}", msg));
+  CHECK(!parse("{\"type\":\"x\"", msg));
+  CHECK(!parse("{\"type\":\"x\"} extra", msg));
+  CHECK(!parse("{\"a\":[[[[[[[[[[1]]]]]]]]]]}", msg));
+
+  // The bounded scan picks out vad_score and ping in either key order, and nothing else.
+  CHECK(scan("{\"vad_score_event\":{\"vad_score\": 0.125},\"type\":\"vad_score\"}", msg));
+  CHECK(msg.type.equals("vad_score") && msg.vad_score == 0.125f);
+  CHECK(scan("{\"type\":\"ping\",\"ping_event\":{\"event_id\":7,\"ping_ms\":50}}", msg));
+  CHECK(msg.type.equals("ping") && msg.event_id == 7 && msg.ping_ms == 50);
+  CHECK(!scan("{\"type\":\"agent_response\",\"agent_response_event\":{\"agent_response\":\"ping\"}}", msg));
+
+  // Cost per message over a mix shaped like the traffic between audio frames.
+  const std::vector<std::string> traffic = {
+      "{\"vad_score_event\":{\"vad_score\":0.0123},\"type\":\"vad_score\"}",
+      "{\"ping_event\":{\"event_id\":17,\"ping_ms\":null},\"type\":\"ping\"}",
+      "{\"type\":\"agent_response\",\"agent_response_event\":{\"agent_response\":\"Naturally, sir. The lights "
+      "in the kitchen are now off.\"}}",
+      "{\"type\":\"user_transcript\",\"user_transcription_event\":{\"user_transcript\":\"Turn off the kitchen "
+      "lights\"}}",
+  };
+  const int rounds = 200000;
+  size_t parsed = 0;
+  double us = time_us([&] {
+    for (int i = 0; i < rounds; i++) {
+      const char *text = traffic[i % traffic.size()].c_str();
+      ControlMessage m;
+      parsed += scan(text, m) || parse(text, m);
+    }
+  });
+  CHECK(parsed == static_cast<size_t>(rounds));
+  std::printf("%.0f ns per control message\n", us * 1000 / rounds);
+  return 0;
+}
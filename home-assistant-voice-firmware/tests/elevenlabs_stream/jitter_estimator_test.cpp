@@ -0,0 +1,66 @@
+// jitter_estimator_test.cpp
+#include "jitter_estimator.h"
+#include "test_support.h"
+
+using namespace esphome::elevenlabs_stream;
+
+// One reply of `frames` frames of 100ms audio, the first arriving at `now`, the rest
+// `spacing_ms` apart, and frame `late_frame` a further `late_ms` behind.
+static uint32_t reply(JitterEstimator &estimator, uint32_t now, int frames, uint32_t spacing_ms,
+                      int late_frame = -1, uint32_t late_ms = 0) {
+  estimator.begin_reply(now);
+  for (int i = 0; i < frames; i++) {
+    estimator.add_frame(now + (i == late_frame ? late_ms : 0), 100);
+    now += spacing_ms;
+  }
+  estimator.end_reply();
+  return now + 2000;
+}
+
+int main() {
+  JitterEstimator estimator;
+  estimator.set_bounds(100, 1500);
+  CHECK(estimator.target_ms() == 400);
+
+  // A link streaming at twice real time needs no cushion: the target decays by an
+  // eighth per reply down to the lower bound.
+  uint32_t now = 1000;
+  now = reply(estimator, now, 20, 50);
+  CHECK(estimator.target_ms() == 350);
+  for (int i = 0; i < 30; i++) {
+    now = reply(estimator, now, 20, 50);
+  }
+  CHECK(estimator.target_ms() == 100);
+  JitterEstimator::Stats stats = estimator.get_stats();
+  CHECK(stats.replies == 31 && stats.frames == 31 * 20);
+  CHECK(stats.last_lag_ms == 0 && stats.jitter_ms == 0);
+  CHECK(stats.realtime_percent > 200);
+
+  // A frame 600ms behind schedule raises the target at once, mid-reply.
+  estimator.begin_reply(now);
+  estimator.add_frame(now, 100);
+  estimator.add_frame(now + 700, 100);
+  CHECK(estimator.target_ms() == 600);
+  estimator.end_reply();
+  CHECK(estimator.get_stats().last_lag_ms == 600);
+  CHECK(estimator.get_stats().jitter_ms > 0);
+
+  // One bad reply is forgotten gradually once the link recovers.
+  now = reply(estimator, now + 3000, 20, 50);
+  CHECK(estimator.target_ms() == 525);
+  for (int i = 0; i < 40; i++) {
+    now = reply(estimator, now, 20, 50);
+  }
+  CHECK(estimator.target_ms() == 100);
+
+  // A reply that stalls for longer than the upper bound is capped there.
+  now = reply(estimator, now, 20, 50, 10, 5000);
+  CHECK(estimator.target_ms() == 1500);
+
+  // reset_stats() clears the counters but keeps what was learnt about the link.
+  estimator.reset_stats();
+  stats = estimator.get_stats();
+  CHECK(stats.replies == 0 && stats.frames == 0 && stats.underruns == 0);
+  CHECK(estimator.target_ms() == 1500);
+  return 0;
+}
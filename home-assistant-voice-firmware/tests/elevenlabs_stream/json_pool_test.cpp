@@ -0,0 +1,148 @@
+// json_pool_test.cpp
+#include "json.h"
+#include "test_support.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+// Counts the calls a document makes on its allocator.
+class CountingAllocator : public ArduinoJson::Allocator {
+ public:
+  void *allocate(size_t size) override {
+    this->calls++;
+    return std::malloc(size);
+  }
+  void deallocate(void *ptr) override {
+    this->calls++;
+    std::free(ptr);
+  }
+  void *reallocate(void *ptr, size_t new_size) override {
+    this->calls++;
+    return std::realloc(ptr, new_size);
+  }
+  size_t calls = 0;
+};
+
+static size_t heap_calls() { return host_heap_calls.mallocs + host_heap_calls.reallocs + host_heap_calls.frees; }
+
+// A message the control message reader turns down, parsed the way
+// parse_json_message_from_buffer() does: from a mutable copy of what was received.
+static JsonDocumentPool::Lease parse(const std::string &message, std::vector<uint8_t> &buffer,
+                                     JsonDocumentPool &pool) {
+  buffer.assign(message.begin(), message.end());
+  return JsonDeserializer::parse(buffer.data(), buffer.size(), pool);
+}
+
+int main() {
+  // An arena hands out its block, grows the latest allocation in place, and takes it
+  // all back once everything is freed.
+  {
+    JsonArena arena;
+    CHECK(arena.reserve(1024));
+    size_t before = heap_calls();
+    void *pool = arena.allocate(512);
+    char *str = static_cast<char *>(arena.allocate(40));
+    CHECK(pool != nullptr && str != nullptr);
+    std::memcpy(str, "conversation_initiation_metadata", 33);
+    CHECK(arena.reallocate(str, 200) == str);
+    CHECK(arena.reallocate(str, 33) == str);
+    CHECK(std::strcmp(str, "conversation_initiation_metadata") == 0);
+    size_t used = arena.used();
+
+    // Shrinking never moves; growing anything but the latest allocation does, contents
+    // and all.
+    CHECK(arena.reallocate(pool, 300) == pool);
+    char *moved = static_cast<char *>(arena.reallocate(str, 64));
+    CHECK(moved == str);
+    void *tail = arena.allocate(8);
+    moved = static_cast<char *>(arena.reallocate(str, 100));
+    CHECK(moved != str && std::strcmp(moved, "conversation_initiation_metadata") == 0);
+    CHECK(arena.used() > used);
+    arena.deallocate(tail);
+
+    // Full: served from the heap, counted, and freed back to it.
+    void *big = arena.allocate(4096);
+    CHECK(big != nullptr && arena.overflows() == 1);
+    arena.deallocate(big);
+    arena.deallocate(moved);
+    arena.deallocate(pool);
+    CHECK(arena.used() == 0);
+    CHECK(heap_calls() - before == 2);
+  }
+
+  std::string message = "{\"type\":\"client_tool_call\",\"client_tool_call\":{\"tool_name\":\"set_light\","
+                        "\"tool_call_id\":\"toolu_01\",\"parameters\":{\"entity_id\":\"light.kitchen\","
+                        "\"brightness\":128,\"transition\":2,\"note\":\"a string longer than thirty-one characters"
+                        " so that it has to grow while it is parsed\"}}}";
+  std::vector<uint8_t> buffer;
+  const int parses = 1000;
+
+  // What a document of its own costs per message, on ArduinoJson 7.
+  CountingAllocator counting;
+  {
+    JsonDocument doc(&counting);
+    for (int i = 0; i < parses; i++) {
+      buffer.assign(message.begin(), message.end());
+      CHECK(deserializeJson(doc, reinterpret_cast<char *>(buffer.data()), buffer.size()) ==
+            DeserializationError::Ok);
+    }
+  }
+  CHECK(counting.calls > 0);
+
+  // Pooled, the same parses never reach the heap.
+  JsonDocumentPool pool;
+  CHECK(pool.allocate(2, 8 * 1024));
+  size_t before = heap_calls();
+  for (int i = 0; i < parses; i++) {
+    JsonDocumentPool::Lease lease = parse(message, buffer, pool);
+    CHECK(lease);
+  }
+  CHECK(heap_calls() == before);
+  JsonDocumentPool::Stats stats = pool.get_stats();
+  CHECK(stats.hits == parses && stats.misses == 0 && stats.fallbacks == 0 && stats.overflows == 0);
+  std::printf("%d parses: %zu allocator calls with a document each, %zu heap calls pooled\n", parses,
+              counting.calls, heap_calls() - before);
+
+  // Two leases at once take both documents; a third message gets one of its own.
+  {
+    JsonDocumentPool::Lease first = parse(message, buffer, pool);
+    std::vector<uint8_t> second_buffer, third_buffer;
+    JsonDocumentPool::Lease second = parse(message, second_buffer, pool);
+    JsonDocumentPool::Lease third = parse(message, third_buffer, pool);
+    CHECK(first && second && third);
+    stats = pool.get_stats();
+    CHECK(stats.misses == 1 && stats.fallbacks == 1);
+  }
+
+  // Too large for a pooled document: allocated on demand and freed again.
+  std::string large = "{\"type\":\"agent_response\",\"agent_response_event\":{\"agent_response\":\"" +
+                      std::string(6000, 'x') + "\"}}";
+  before = host_heap_calls.frees;
+  size_t mallocs = host_heap_calls.mallocs + host_heap_calls.reallocs;
+  {
+    JsonDocumentPool::Lease lease = parse(large, buffer, pool);
+    CHECK(lease);
+  }
+  CHECK(pool.get_stats().fallbacks == 2);
+  CHECK(host_heap_calls.mallocs + host_heap_calls.reallocs > mallocs && host_heap_calls.frees > before);
+
+  // A message with more in it than an arena holds still parses, partly from the heap,
+  // and gives every byte of that back.
+  std::string crowded = "{\"type\":\"contextual_update\"";
+  while (crowded.size() < 2000) {
+    crowded += ",\"k" + std::to_string(crowded.size()) + "\":1";
+  }
+  crowded += "}";
+  size_t mallocs_before = host_heap_calls.mallocs;
+  size_t frees_before = host_heap_calls.frees;
+  {
+    JsonDocumentPool::Lease lease = parse(crowded, buffer, pool);
+    CHECK(lease);
+  }
+  stats = pool.get_stats();
+  CHECK(stats.fallbacks == 2 && stats.overflows > 0);
+  CHECK(host_heap_calls.mallocs - mallocs_before == host_heap_calls.frees - frees_before);
+  return 0;
+}
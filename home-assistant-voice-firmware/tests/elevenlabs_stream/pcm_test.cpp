@@ -0,0 +1,78 @@
+// pcm_test.cpp
+#include "pcm.h"
+#include "test_support.h"
+#include <random>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+int main() {
+  std::mt19937 rng(1);
+
+  // The fused conversion matches the old two passes -- top 16 bits, then the average of
+  // the pair -- bit for bit, for every length and an unaligned output.
+  for (int round = 0; round < 2000; round++) {
+    size_t frames = rng() % 300;
+    std::vector<int32_t> in(frames * 2);
+    for (auto &x : in) {
+      x = static_cast<int32_t>(rng());
+    }
+    if (round % 5 == 0) {
+      // Near zero, where rounding toward zero matters.
+      for (auto &x : in) {
+        x = static_cast<int32_t>(static_cast<uint32_t>(static_cast<int>(rng() % 3) - 1) << 16 | (rng() & 0xFFFF));
+      }
+    }
+    std::vector<int16_t> expected(frames);
+    for (size_t i = 0; i < frames; i++) {
+      int32_t sum = static_cast<int16_t>(in[2 * i] >> 16) + static_cast<int16_t>(in[2 * i + 1] >> 16);
+      expected[i] = static_cast<int16_t>(sum / 2);
+    }
+    std::vector<int16_t> reference(frames), fused(frames + 1);
+    CHECK(stereo_s32_to_mono_s16_reference(in.data(), frames, reference.data()) == frames);
+    CHECK(stereo_s32_to_mono_s16(in.data(), frames, fused.data() + 1) == frames);
+    for (size_t i = 0; i < frames; i++) {
+      CHECK(reference[i] == expected[i]);
+      CHECK(fused[i + 1] == expected[i]);
+    }
+  }
+
+  // A single channel is the top 16 bits of every second sample.
+  std::vector<int32_t> in(2 * 1025);
+  for (auto &x : in) {
+    x = static_cast<int32_t>(rng());
+  }
+  std::vector<int16_t> out(1025);
+  for (size_t channel = 0; channel < 2; channel++) {
+    for (size_t frames : {0, 1, 2, 3, 1024, 1025}) {
+      CHECK(stereo_s32_channel_to_mono_s16(in.data(), frames, channel, out.data()) == frames);
+      for (size_t i = 0; i < frames; i++) {
+        CHECK(out[i] == static_cast<int16_t>(in[2 * i + channel] >> 16));
+      }
+    }
+  }
+
+  // Per-frame cost of averaging against taking one channel, in 512-frame blocks.
+  const int blocks = 200000;
+  std::vector<int32_t> block(2 * 512);
+  for (auto &x : block) {
+    x = static_cast<int32_t>(rng());
+  }
+  std::vector<int16_t> mono(512);
+  volatile int16_t sink = 0;
+  double mix_us = time_us([&] {
+    for (int k = 0; k < blocks; k++) {
+      stereo_s32_to_mono_s16(block.data(), 512, mono.data());
+      sink = mono[k & 511];
+    }
+  });
+  double single_us = time_us([&] {
+    for (int k = 0; k < blocks; k++) {
+      stereo_s32_channel_to_mono_s16(block.data(), 512, 0, mono.data());
+      sink = mono[k & 511];
+    }
+  });
+  std::printf("mix %.2f ns/frame, single channel %.2f ns/frame\n", mix_us * 1000 / blocks / 512,
+              single_us * 1000 / blocks / 512);
+  return 0;
+}
@@ -0,0 +1,195 @@
+// playback_sink_test.cpp
+#include "playback_sink.h"
+#include "esphome/components/speaker/speaker.h"
+#include "test_support.h"
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace esphome;
+using namespace esphome::elevenlabs_stream;
+
+// Takes up to `limit` bytes a call, in whole multiples of `unit`, and keeps them.
+class FakeSpeaker : public speaker::Speaker {
+ public:
+  size_t play(const uint8_t *data, size_t length, TickType_t ticks_to_wait) override {
+    size_t n = std::min(length, this->limit) / this->unit * this->unit;
+    this->played.insert(this->played.end(), data, data + n);
+    if (this->during_play) {
+      this->during_play();
+    }
+    return n;
+  }
+  size_t limit = SIZE_MAX;
+  size_t unit = 1;
+  std::vector<uint8_t> played;
+  // Runs inside play(), after the speaker has copied the span: what another task does
+  // while the playback task is in there.
+  std::function<void()> during_play;
+};
+
+int main() {
+  // Full and empty are told apart with no byte wasted, for a capacity that is not a
+  // power of two: the indices run modulo twice the capacity.
+  {
+    PlaybackSink sink;
+    FakeSpeaker speaker;
+    sink.set_speaker(&speaker);
+    CHECK(sink.allocate(10));
+    CHECK(sink.available() == 0 && sink.free_space() == 10);
+    std::vector<uint8_t> data(10);
+    for (int i = 0; i < 10; i++) {
+      data[i] = i;
+    }
+    CHECK(sink.write(data.data(), 10) == 10);
+    CHECK(sink.available() == 10 && sink.free_space() == 0);
+    size_t len = 0;
+    CHECK(sink.acquire(len) == nullptr && len == 0);
+    CHECK(sink.write(data.data(), 1) == 0);
+    CHECK(sink.pump(0) == 10 && speaker.played == data);
+    CHECK(sink.available() == 0 && sink.free_space() == 10);
+    CHECK(sink.pump(0) == 0);
+  }
+
+  // Random writes and reads through both interfaces wrap the ring, and the indices past
+  // twice the capacity, hundreds of times. What comes out is what went in.
+  {
+    std::mt19937 rng(7);
+    PlaybackSink sink;
+    FakeSpeaker speaker;
+    sink.set_speaker(&speaker);
+    CHECK(sink.allocate(7));
+    std::vector<uint8_t> written, read;
+    uint8_t next = 0;
+    for (int round = 0; round < 5000; round++) {
+      if (rng() % 2 == 0) {
+        size_t len = 0;
+        uint8_t *span = sink.acquire(len);
+        CHECK(len <= sink.free_space());
+        size_t n = len > 0 ? rng() % len + 1 : 0;
+        for (size_t i = 0; i < n; i++) {
+          span[i] = next;
+          written.push_back(next++);
+        }
+        sink.commit(n);
+      } else {
+        std::vector<uint8_t> block(rng() % 9);
+        for (auto &x : block) {
+          x = next++;
+        }
+        size_t n = sink.write(block.data(), block.size());
+        next -= block.size() - n;
+        written.insert(written.end(), block.begin(), block.begin() + n);
+      }
+      CHECK(sink.available() + sink.free_space() == 7);
+      if (rng() % 2 == 0) {
+        speaker.limit = rng() % 8;
+        sink.pump(0);
+      } else {
+        size_t len = 0;
+        const uint8_t *span = sink.peek(len);
+        size_t n = len > 0 ? rng() % len + 1 : 0;
+        speaker.played.insert(speaker.played.end(), span, span + n);
+        sink.consume(n);
+      }
+    }
+    CHECK(written.size() > 5000);
+    speaker.limit = SIZE_MAX;
+    while (sink.pump(0) > 0) {
+    }
+    CHECK(speaker.played == written);
+  }
+
+  // A clear() landing while pump() is inside play() stands: the pump's advance from the
+  // old position is dropped, and nothing from before the clear is played again.
+  {
+    PlaybackSink sink;
+    FakeSpeaker speaker;
+    sink.set_speaker(&speaker);
+    CHECK(sink.allocate(16));
+    std::vector<uint8_t> data(12, 1);
+    sink.write(data.data(), 12);
+    speaker.limit = 4;
+    speaker.during_play = [&] {
+      sink.clear();
+      std::vector<uint8_t> fresh(3, 2);
+      sink.write(fresh.data(), 3);
+    };
+    CHECK(sink.pump(0) == 4);
+    speaker.during_play = nullptr;
+    CHECK(sink.available() == 3);
+    speaker.limit = SIZE_MAX;
+    speaker.played.clear();
+    CHECK(sink.pump(0) == 3 && speaker.played == std::vector<uint8_t>(3, 2));
+
+    // With the ring full when it is cleared, the span being played is exactly where the
+    // writer goes next. It stays off it until play() returns.
+    std::vector<uint8_t> full(16, 3);
+    CHECK(sink.write(full.data(), 16) == 16);
+    size_t written_during_play = SIZE_MAX;
+    speaker.limit = 4;
+    speaker.during_play = [&] {
+      sink.clear();
+      written_during_play = sink.write(data.data(), 12);
+    };
+    CHECK(sink.pump(0) > 0);
+    CHECK(written_during_play == 0 && sink.available() == 0 && sink.free_space() == 16);
+  }
+
+  // The receive side writing, the playback task pumping and clear() called from a third
+  // task, all at once. Audio is written as 32-bit sample counters and the speaker takes
+  // whole ones, so a sample played twice, out of order or torn shows up.
+  {
+    PlaybackSink sink;
+    FakeSpeaker speaker;
+    sink.set_speaker(&speaker);
+    CHECK(sink.allocate(256));
+    speaker.unit = 4;
+    speaker.limit = 64;
+    const uint32_t samples = 2000000;
+    std::atomic<bool> done{false};
+    std::thread writer([&] {
+      for (uint32_t counter = 1; counter <= samples;) {
+        size_t len = 0;
+        uint8_t *span = sink.acquire(len);
+        size_t n = 0;
+        for (; n + 4 <= len && counter <= samples; n += 4, counter++) {
+          memcpy(span + n, &counter, 4);
+        }
+        sink.commit(n);
+        if (n == 0) {
+          std::this_thread::yield();
+        }
+      }
+      done.store(true);
+    });
+    std::thread clearer([&] {
+      for (uint32_t i = 0; !done.load(); i++) {
+        if (i % 64 == 0) {
+          sink.clear();
+        }
+        std::this_thread::yield();
+      }
+    });
+    while (!done.load() || sink.available() > 0) {
+      if (sink.pump(0) == 0) {
+        std::this_thread::yield();
+      }
+    }
+    writer.join();
+    clearer.join();
+    CHECK(speaker.played.size() % 4 == 0);
+    uint32_t last = 0;
+    for (size_t i = 0; i < speaker.played.size(); i += 4) {
+      uint32_t counter;
+      memcpy(&counter, speaker.played.data() + i, 4);
+      CHECK(counter > last);
+      last = counter;
+    }
+    std::printf("stress: %zu of %u samples played around the clears\n", speaker.played.size() / 4, samples);
+  }
+  return 0;
+}
@@ -0,0 +1,7 @@
+// Host stand-in: only the types the component headers name.
+#pragma once
+#include <cstdint>
+
+typedef const char *esp_event_base_t;
+typedef int esp_err_t;
+#define ESP_OK 0
@@ -0,0 +1,31 @@
+// Host stand-in: every capability is plain malloc.
+#pragma once
+#include <cstddef>
+#include <cstdlib>
+
+#define MALLOC_CAP_SPIRAM (1 << 10)
+#define MALLOC_CAP_8BIT (1 << 2)
+#define MALLOC_CAP_INTERNAL (1 << 11)
+
+// Calls made so far, so a test can tell whether a path touches the heap at all.
+struct HostHeapCalls {
+  size_t mallocs;
+  size_t reallocs;
+  size_t frees;
+};
+inline HostHeapCalls host_heap_calls{};
+
+inline void *heap_caps_malloc(size_t size, int caps) {
+  host_heap_calls.mallocs++;
+  return std::malloc(size);
+}
+inline void *heap_caps_realloc(void *ptr, size_t size, int caps) {
+  host_heap_calls.reallocs++;
+  return std::realloc(ptr, size);
+}
+inline void heap_caps_free(void *ptr) {
+  host_heap_calls.frees++;
+  std::free(ptr);
+}
+inline size_t heap_caps_get_free_size(int caps) { return 4 * 1024 * 1024; }
+inline size_t heap_caps_get_largest_free_block(int caps) { return 4 * 1024 * 1024; }
@@ -0,0 +1,18 @@
+// Host stand-in: the types websocket_client.h names. Nothing here is linked; tests use
+// the stream handler interface, and build data events by hand for the assembler.
+#pragma once
+#include "esp_event.h"
+#include <freertos/FreeRTOS.h>
+
+typedef struct esp_websocket_client *esp_websocket_client_handle_t;
+
+typedef struct {
+  const char *data_ptr;
+  int data_len;
+  bool fin;
+  uint8_t op_code;
+  esp_websocket_client_handle_t client;
+  void *user_context;
+  int payload_len;
+  int payload_offset;
+} esp_websocket_event_data_t;
@@ -0,0 +1,196 @@
+// Host stand-in for the ArduinoJson types json.h and control_message.cpp name.
+//
+// ArduinoJson is not available to the host build. Code written against these types
+// compiles, but every lookup comes back null. JsonDocument does not build a tree either;
+// it makes the calls on its Allocator that ArduinoJson 7 makes while parsing -- a slot
+// pool per 64 values, and a string buffer per string that starts at 31 characters,
+// doubles as it fills and is shrunk to fit -- which is what the pool tests look at.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+class JsonObject;
+
+class JsonString {
+ public:
+  JsonString(const char *s = nullptr) : s_(s) {}
+  const char *c_str() const { return this->s_; }
+  size_t size() const { return this->s_ != nullptr ? std::char_traits<char>::length(this->s_) : 0; }
+  bool isNull() const { return this->s_ == nullptr; }
+
+ private:
+  const char *s_;
+};
+
+class JsonVariant {
+ public:
+  JsonVariant operator[](const char *key) const { return {}; }
+  template<typename T> T as() const { return T(); }
+  template<typename T> bool is() const { return false; }
+  bool isNull() const { return true; }
+  operator JsonObject() const;
+  template<typename T> T operator|(T fallback) const { return fallback; }
+};
+
+class JsonObject {
+ public:
+  JsonVariant operator[](const char *key) const { return {}; }
+  explicit operator bool() const { return false; }
+  bool isNull() const { return true; }
+};
+
+inline JsonVariant::operator JsonObject() const { return {}; }
+
+namespace ArduinoJson {
+
+class Allocator {
+ public:
+  virtual void *allocate(size_t size) = 0;
+  virtual void deallocate(void *ptr) = 0;
+  virtual void *reallocate(void *ptr, size_t new_size) = 0;
+
+ protected:
+  ~Allocator() = default;
+};
+
+class MallocAllocator : public Allocator {
+ public:
+  static MallocAllocator *instance() {
+    static MallocAllocator allocator;
+    return &allocator;
+  }
+  void *allocate(size_t size) override { return std::malloc(size); }
+  void deallocate(void *ptr) override { std::free(ptr); }
+  void *reallocate(void *ptr, size_t new_size) override { return std::realloc(ptr, new_size); }
+};
+
+}  // namespace ArduinoJson
+
+class DeserializationError {
+ public:
+  enum Code { Ok, EmptyInput, IncompleteInput, NoMemory };
+  DeserializationError(Code code = Ok) : code_(code) {}
+  bool operator==(Code code) const { return this->code_ == code; }
+  bool operator!=(Code code) const { return this->code_ != code; }
+  const char *c_str() const {
+    static const char *const NAMES[] = {"Ok", "EmptyInput", "IncompleteInput", "NoMemory"};
+    return NAMES[this->code_];
+  }
+
+ private:
+  Code code_;
+};
+
+class JsonDocument {
+ public:
+  explicit JsonDocument(ArduinoJson::Allocator *allocator = ArduinoJson::MallocAllocator::instance())
+      : allocator_(allocator) {}
+  JsonDocument(const JsonDocument &) = delete;
+  JsonDocument &operator=(const JsonDocument &) = delete;
+  ~JsonDocument() { this->clear(); }
+
+  template<typename T> T as() { return T(); }
+  bool overflowed() const { return this->overflowed_; }
+  void shrinkToFit() {}
+  // Gives every allocation back, as ArduinoJson 7 does.
+  void clear() {
+    for (void *block : this->blocks_) {
+      this->allocator_->deallocate(block);
+    }
+    this->blocks_.clear();
+    this->overflowed_ = false;
+  }
+
+  DeserializationError parse(const char *input, size_t len) {
+    static const size_t SLOT_BYTES = 8, POOL_SLOTS = 64, STRING_HEADER = 8;
+    this->clear();
+    if (len == 0) {
+      return DeserializationError::EmptyInput;
+    }
+    size_t values = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (i == 0 || input[i] == ':' || input[i] == ',') {
+        if (values++ % POOL_SLOTS == 0 && this->allocate(SLOT_BYTES * POOL_SLOTS) == nullptr) {
+          return DeserializationError::NoMemory;
+        }
+      }
+      if (input[i] != '"') {
+        continue;
+      }
+      size_t capacity = 31, length = 0;
+      size_t index = this->blocks_.size();
+      char *str = static_cast<char *>(this->allocate(STRING_HEADER + capacity + 1));
+      for (i++; i < len && input[i] != '"'; i++) {
+        if (str == nullptr) {
+          return DeserializationError::NoMemory;
+        }
+        if (length == capacity) {
+          capacity *= 2;
+          str = static_cast<char *>(this->reallocate(index, STRING_HEADER + capacity + 1));
+          if (str == nullptr) {
+            return DeserializationError::NoMemory;
+          }
+        }
+        str[STRING_HEADER + length++] = input[i];
+      }
+      if (i == len) {
+        return DeserializationError::IncompleteInput;
+      }
+      if (str == nullptr || this->reallocate(index, STRING_HEADER + length + 1) == nullptr) {
+        return DeserializationError::NoMemory;
+      }
+    }
+    return DeserializationError::Ok;
+  }
+
+ private:
+  void *allocate(size_t size) {
+    void *block = this->allocator_->allocate(size);
+    if (block == nullptr) {
+      this->overflowed_ = true;
+      return nullptr;
+    }
+    this->blocks_.push_back(block);
+    return block;
+  }
+  void *reallocate(size_t index, size_t size) {
+    void *block = this->allocator_->reallocate(this->blocks_[index], size);
+    if (block == nullptr) {
+      this->overflowed_ = true;
+      return nullptr;
+    }
+    this->blocks_[index] = block;
+    return block;
+  }
+
+  ArduinoJson::Allocator *allocator_;
+  std::vector<void *> blocks_;
+  bool overflowed_{false};
+};
+
+// ArduinoJson 7 keeps this as a deprecated adapter from a v6-style allocator.
+template<typename T> class BasicJsonDocument : public JsonDocument {
+ public:
+  explicit BasicJsonDocument(size_t capacity) : JsonDocument(&adapter_), capacity_(capacity) {}
+  size_t capacity() const { return this->capacity_; }
+
+ private:
+  struct Adapter : ArduinoJson::Allocator {
+    void *allocate(size_t size) override { return T().allocate(size); }
+    void deallocate(void *ptr) override { T().deallocate(ptr); }
+    void *reallocate(void *ptr, size_t new_size) override { return T().reallocate(ptr, new_size); }
+  };
+  // Static so it is constructed before the base class that is handed a pointer to it.
+  static inline Adapter adapter_;
+  size_t capacity_;
+};
+
+inline DeserializationError deserializeJson(JsonDocument &doc, const char *input, size_t len) {
+  return doc.parse(input, len);
+}
+
+inline size_t serializeJson(const JsonObject &obj, std::string &out) { return 0; }
@@ -0,0 +1,17 @@
+// Host stand-in for the one Speaker call PlaybackSink makes. Tests implement play().
+#pragma once
+#include <freertos/FreeRTOS.h>
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace speaker {
+
+class Speaker {
+ public:
+  virtual ~Speaker() = default;
+  virtual size_t play(const uint8_t *data, size_t length, TickType_t ticks_to_wait) = 0;
+};
+
+}  // namespace speaker
+}  // namespace esphome
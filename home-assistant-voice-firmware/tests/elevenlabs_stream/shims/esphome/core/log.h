@@ -0,0 +1,28 @@
+// Host stand-in for esphome/core/log.h: warnings and errors go to stderr, the rest is
+// dropped so test output stays readable.
+#pragma once
+#include <cstdio>
+
+#define ESPHOME_LOG_LEVEL_NONE 0
+#define ESPHOME_LOG_LEVEL_ERROR 1
+#define ESPHOME_LOG_LEVEL_WARN 2
+#define ESPHOME_LOG_LEVEL_INFO 3
+#define ESPHOME_LOG_LEVEL_DEBUG 5
+#define ESPHOME_LOG_LEVEL_VERBOSE 6
+#ifndef ESPHOME_LOG_LEVEL
+#define ESPHOME_LOG_LEVEL ESPHOME_LOG_LEVEL_WARN
+#endif
+
+// Cleared by tests that feed a component malformed input on purpose, many times over.
+inline bool host_log_enabled = true;
+
+#define HOST_LOG(level, tag, ...) \
+  (host_log_enabled \
+       ? (std::fprintf(stderr, "[" level "][%s] ", tag), std::fprintf(stderr, __VA_ARGS__), std::fputc('\n', stderr)) \
+       : 0)
+#define ESP_LOGE(tag, ...) HOST_LOG("E", tag, __VA_ARGS__)
+#define ESP_LOGW(tag, ...) HOST_LOG("W", tag, __VA_ARGS__)
+#define ESP_LOGI(tag, ...) ((void) 0)
+#define ESP_LOGD(tag, ...) ((void) 0)
+#define ESP_LOGV(tag, ...) ((void) 0)
+#define ESP_LOGCONFIG(tag, ...) ((void) 0)
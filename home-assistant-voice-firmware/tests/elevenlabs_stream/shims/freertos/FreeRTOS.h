@@ -0,0 +1,13 @@
+// Host stand-in: the FreeRTOS types and macros the component headers name.
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+#define pdMS_TO_TICKS(ms) ((TickType_t) (ms))
+#define portMAX_DELAY ((TickType_t) 0xffffffffUL)
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
@@ -0,0 +1,5 @@
+// Host stand-in: declarations only.
+#pragma once
+#include "queue.h"
+
+typedef void *SemaphoreHandle_t;
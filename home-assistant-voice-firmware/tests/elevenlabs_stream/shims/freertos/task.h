@@ -0,0 +1,5 @@
+// Host stand-in: declarations only.
+#pragma once
+#include "FreeRTOS.h"
+
+typedef void *TaskHandle_t;
@@ -0,0 +1,21 @@
+// test_support.h
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+// Like assert(), but also in release builds, and it names the check that failed.
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) { \
+      std::fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, #condition); \
+      std::exit(1); \
+    } \
+  } while (0)
+
+// Microseconds taken by `body`.
+template<typename F> double time_us(F &&body) {
+  auto start = std::chrono::steady_clock::now();
+  body();
+  return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+}
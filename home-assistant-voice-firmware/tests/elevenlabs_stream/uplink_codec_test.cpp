@@ -0,0 +1,109 @@
+// uplink_codec_test.cpp
+#include "uplink_codec.h"
+#include "test_support.h"
+#include <cmath>
+#include <algorithm>
+#include <cstring>
+#include <random>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+// G.711 decode, as the far end does it.
+static int16_t ulaw_decode(uint8_t code) {
+  code = ~code;
+  int magnitude = (((code & 0x0F) << 3) + 0x84) << ((code & 0x70) >> 4);
+  return (code & 0x80) ? (0x84 - magnitude) : (magnitude - 0x84);
+}
+
+// The segment search the table replaces: the highest set bit of the biased magnitude.
+static uint8_t ulaw_encode_reference(int16_t sample) {
+  int value = sample;
+  uint8_t sign = 0;
+  if (value < 0) {
+    value = -value;
+    sign = 0x80;
+  }
+  value = std::min(value, 32635) + 0x84;
+  int segment = 7;
+  for (int bit = 0x4000; (value & bit) == 0 && segment > 0; bit >>= 1) {
+    segment--;
+  }
+  return ~(sign | (segment << 4) | ((value >> (segment + 3)) & 0x0F));
+}
+
+// Gain in dB of a full second of a sine at `hz` through the encoder and back.
+static double gain_db(double hz) {
+  const double amplitude = 10000;
+  std::vector<int16_t> in(16000);
+  for (size_t i = 0; i < in.size(); i++) {
+    in[i] = static_cast<int16_t>(amplitude * std::sin(2 * M_PI * hz * i / 16000));
+  }
+  UlawEncoder encoder;
+  encoder.reset();
+  std::vector<uint8_t> out(in.size() / 2);
+  size_t n = encoder.encode(in.data(), in.size(), out.data());
+  CHECK(n == in.size() / 2);
+  // Skip the filter's start-up.
+  double power = 0;
+  for (size_t i = 1000; i < n; i++) {
+    double x = ulaw_decode(out[i]);
+    power += x * x;
+  }
+  power /= n - 1000;
+  return 10 * std::log10(power / (amplitude * amplitude / 2));
+}
+
+int main() {
+  // The table gives the same code as the search for every input.
+  for (int v = -32768; v <= 32767; v++) {
+    CHECK(ulaw_encode(static_cast<int16_t>(v)) == ulaw_encode_reference(static_cast<int16_t>(v)));
+  }
+
+  // Round trip within mu-law quantisation: a step is at most 1/16 of the segment.
+  for (int v = -32000; v <= 32000; v += 7) {
+    int error = std::abs(ulaw_decode(ulaw_encode(static_cast<int16_t>(v))) - v);
+    CHECK(error <= std::abs(v) / 16 + 8);
+  }
+
+  // Speech band passes, what would alias is stopped.
+  double g1000 = gain_db(1000), g3400 = gain_db(3400), g5000 = gain_db(5000);
+  std::printf("gain: 1 kHz %.1f dB, 3.4 kHz %.1f dB, 5 kHz %.1f dB\n", g1000, g3400, g5000);
+  CHECK(std::fabs(g1000) < 0.5);
+  CHECK(g3400 > -0.5);
+  CHECK(g5000 < -50);
+
+  // Blocks of any length, odd included, give the same output as one call.
+  std::mt19937 rng(2);
+  std::vector<int16_t> in(20001);
+  for (auto &x : in) {
+    x = static_cast<int16_t>(rng() % 20000) - 10000;
+  }
+  UlawEncoder whole;
+  whole.reset();
+  std::vector<uint8_t> expected((in.size() + 1) / 2);
+  size_t expected_len = whole.encode(in.data(), in.size(), expected.data());
+  UlawEncoder split;
+  split.reset();
+  std::vector<uint8_t> got(expected.size());
+  size_t got_len = 0;
+  for (size_t pos = 0; pos < in.size();) {
+    size_t count = std::min<size_t>(rng() % 700 + 1, in.size() - pos);
+    got_len += split.encode(in.data() + pos, count, got.data() + got_len);
+    pos += count;
+  }
+  CHECK(got_len == expected_len);
+  CHECK(got == expected);
+
+  // Throughput, for comparison between changes.
+  std::vector<int16_t> minute(16000 * 60);
+  for (auto &x : minute) {
+    x = static_cast<int16_t>(rng());
+  }
+  std::vector<uint8_t> encoded(minute.size() / 2);
+  UlawEncoder bench;
+  bench.reset();
+  double us = time_us([&] { bench.encode(minute.data(), minute.size(), encoded.data()); });
+  std::printf("60s of 16 kHz audio encoded in %.1f ms\n", us / 1000);
+  return 0;
+}
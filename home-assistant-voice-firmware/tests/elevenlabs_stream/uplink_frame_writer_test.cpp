@@ -0,0 +1,85 @@
+// uplink_frame_writer_test.cpp
+#include "uplink_frame_writer.h"
+#include "base64.h"
+#include "test_support.h"
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+// Counts heap allocations, to check that steady streaming makes none.
+static size_t allocations = 0;
+
+void *operator new(size_t size) {
+  allocations++;
+  if (void *p = std::malloc(size != 0 ? size : 1)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+// The frame as it used to be put together: a base64 string, then JSON around it.
+// ArduinoJson is not available on the host, so the copy into its document is left out
+// and this understates what the old path cost.
+static std::string old_frame(const uint8_t *pcm, size_t len) {
+  std::string encoded = base64_encode(pcm, len);
+  std::string frame = "{\"user_audio_chunk\":\"";
+  frame += encoded;
+  frame += "\"}";
+  return frame;
+}
+
+int main() {
+  std::mt19937 rng(1);
+  // 20ms, 40ms and 100ms blocks of 16 kHz 16-bit mono, and the edge cases of base64.
+  std::vector<uint8_t> pcm(3200);
+  for (auto &b : pcm) {
+    b = static_cast<uint8_t>(rng());
+  }
+
+  UplinkFrameWriter writer;
+  for (size_t len : {0, 1, 2, 3, 4, 640, 1280, 3200, 640}) {
+    size_t size = writer.build(pcm.data(), len);
+    CHECK(size == writer.size());
+    CHECK(std::string(writer.data(), size) == old_frame(pcm.data(), len));
+  }
+
+  // Once reserved, frames up to that size reuse the buffer.
+  UplinkFrameWriter steady;
+  steady.reserve(1280);
+  const char *buffer = steady.data();
+  size_t before = allocations;
+  for (int i = 0; i < 1000; i++) {
+    steady.build(pcm.data(), i % 2 ? 640 : 1280);
+  }
+  CHECK(allocations == before);
+  CHECK(steady.data() == buffer);
+
+  // Time per 40ms frame, and the bytes each path writes.
+  const int rounds = 100000;
+  size_t sink = 0;
+  double writer_us = time_us([&] {
+    for (int i = 0; i < rounds; i++) {
+      sink += steady.build(pcm.data(), 1280);
+    }
+  });
+  before = allocations;
+  double old_us = time_us([&] {
+    for (int i = 0; i < rounds; i++) {
+      sink += old_frame(pcm.data(), 1280).size();
+    }
+  });
+  size_t old_allocations = (allocations - before) / rounds;
+  CHECK(sink > 0);
+  size_t encoded = base64_encoded_size(1280);
+  std::printf("40ms frame: writer %.0f ns, %zu bytes written, no allocations; string path %.0f ns, %zu bytes "
+              "written, %zu allocations\n",
+              writer_us * 1000 / rounds, steady.size(), old_us * 1000 / rounds, encoded + steady.size(),
+              old_allocations);
+  return 0;
+}
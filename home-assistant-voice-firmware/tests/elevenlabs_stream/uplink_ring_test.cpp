@@ -0,0 +1,181 @@
+// uplink_ring_test.cpp
+#include "uplink_ring.h"
+#include "test_support.h"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+// Starts both indices just short of where uint32_t wraps.
+class TestRing : public UplinkRing {
+ public:
+  void start_at(uint32_t index) {
+    this->head_.store(index);
+    this->tail_.store(index);
+  }
+};
+
+static std::vector<int16_t> sequence(int first, size_t count) {
+  std::vector<int16_t> samples(count);
+  for (size_t i = 0; i < count; i++) {
+    samples[i] = static_cast<int16_t>(first + i);
+  }
+  return samples;
+}
+
+// Every sample the stress runs push is one half of a 32-bit counter. Each call moves
+// the indices by an even amount, so a pair is never split and the counter read back
+// must only ever go up.
+struct CounterCheck {
+  uint32_t last = 0;
+  bool started = false;
+  uint64_t popped = 0;
+
+  void take(const int16_t *samples, size_t count) {
+    CHECK(count % 2 == 0);
+    for (size_t i = 0; i < count; i += 2) {
+      uint32_t value = static_cast<uint16_t>(samples[i]) |
+                       static_cast<uint32_t>(static_cast<uint16_t>(samples[i + 1])) << 16;
+      CHECK(!started || value > last);
+      last = value;
+      started = true;
+    }
+    popped += count;
+  }
+};
+
+// A producer pushing pairs of samples as fast as it can, a consumer popping them, and a
+// third task calling `meddle` on the ring now and then.
+template<typename Meddle>
+static void stress(UplinkRing &ring, uint32_t pairs, Meddle &&meddle, CounterCheck &check) {
+  std::atomic<bool> done{false};
+  std::thread producer([&] {
+    int16_t block[8];
+    for (uint32_t counter = 1; counter <= pairs; counter += 4) {
+      for (int k = 0; k < 4; k++) {
+        block[2 * k] = static_cast<int16_t>((counter + k) & 0xFFFF);
+        block[2 * k + 1] = static_cast<int16_t>((counter + k) >> 16);
+      }
+      ring.push(block, 8);
+      // Blocks arrive from the microphone a few at a time; on a single core this is
+      // also what lets the consumer in between.
+      if (counter % 256 == 1) {
+        std::this_thread::yield();
+      }
+    }
+    done.store(true);
+  });
+  std::thread meddler([&] {
+    while (!done.load()) {
+      meddle();
+      std::this_thread::yield();
+    }
+  });
+  int16_t out[64];
+  size_t count;
+  while (!done.load()) {
+    if ((count = ring.pop(out, 2 * (1 + check.popped % 32))) > 0) {
+      check.take(out, count);
+    } else {
+      std::this_thread::yield();
+    }
+  }
+  while ((count = ring.pop(out, 64)) > 0) {
+    check.take(out, count);
+  }
+  producer.join();
+  meddler.join();
+}
+
+int main() {
+  // Capacity rounds up to a power of two.
+  {
+    UplinkRing ring;
+    CHECK(ring.allocate(5));
+    CHECK(ring.capacity() == 8);
+  }
+
+  // The free-running indices wrap past 2^32 and the buffer position past its end without
+  // a sample out of place.
+  {
+    TestRing ring;
+    CHECK(ring.allocate(8));
+    ring.start_at(0xFFFFFFF0u);
+    int next_in = 0, next_out = 0;
+    for (int round = 0; round < 100; round++) {
+      size_t n = 1 + round % 7;
+      auto block = sequence(next_in, n);
+      size_t overflow = std::max(0, next_in + static_cast<int>(n) - next_out - 8);
+      CHECK(ring.push(block.data(), n) == overflow);
+      next_in += n;
+      next_out += overflow;
+      int16_t out[8];
+      size_t got = ring.pop(out, 1 + round % 5);
+      for (size_t i = 0; i < got; i++) {
+        CHECK(out[i] == static_cast<int16_t>(next_out++));
+      }
+      CHECK(ring.available() == static_cast<size_t>(next_in - next_out));
+    }
+  }
+
+  // Full: the oldest samples go to make room, and are counted.
+  {
+    UplinkRing ring;
+    CHECK(ring.allocate(8));
+    auto first = sequence(0, 6);
+    CHECK(ring.push(first.data(), 6) == 0);
+    auto second = sequence(6, 6);
+    CHECK(ring.push(second.data(), 6) == 4);
+    int16_t out[8];
+    CHECK(ring.pop(out, 8) == 8);
+    for (int i = 0; i < 8; i++) {
+      CHECK(out[i] == 4 + i);
+    }
+
+    // A block larger than the ring keeps only its newest samples.
+    auto large = sequence(100, 20);
+    CHECK(ring.push(large.data(), 20) == 12);
+    CHECK(ring.pop(out, 8) == 8 && out[0] == 112 && out[7] == 119);
+
+    UplinkRing::Stats stats = ring.get_stats();
+    CHECK(stats.pushed == 20 && stats.dropped == 16 && stats.high_water == 8);
+
+    // trim() keeps the newest, clear() drops everything.
+    CHECK(ring.push(first.data(), 6) == 0);
+    CHECK(ring.trim(2) == 4 && ring.available() == 2);
+    CHECK(ring.pop(out, 8) == 2 && out[0] == 4 && out[1] == 5);
+    CHECK(ring.trim(2) == 0);
+    CHECK(ring.get_stats().trimmed == 4);
+    CHECK(ring.push(first.data(), 6) == 0);
+    ring.clear();
+    CHECK(ring.available() == 0 && ring.pop(out, 8) == 0);
+  }
+
+  // The two tasks at once, the producer lapping the consumer, with trim() called from a
+  // third the way the uplink task trims the connect buffer. Every sample pushed is
+  // popped, dropped or trimmed exactly once, in order.
+  {
+    UplinkRing ring;
+    CHECK(ring.allocate(256));
+    CounterCheck check;
+    const uint32_t pairs = 2000000;
+    stress(ring, pairs, [&] { ring.trim(2 * (ring.available() / 4)); }, check);
+    UplinkRing::Stats stats = ring.get_stats();
+    CHECK(stats.pushed == 2 * pairs);
+    CHECK(check.popped + stats.dropped + stats.trimmed == stats.pushed);
+    std::printf("stress: %llu popped, %u dropped, %u trimmed\n", static_cast<unsigned long long>(check.popped),
+                stats.dropped, stats.trimmed);
+  }
+
+  // And with clear() from a third task, as start_stream() and stop_capture() do from the
+  // main task: whatever comes out after it is still newer than anything before it.
+  {
+    UplinkRing ring;
+    CHECK(ring.allocate(256));
+    CounterCheck check;
+    stress(ring, 2000000, [&] { ring.clear(); }, check);
+    CHECK(check.popped > 0);
+  }
+  return 0;
+}
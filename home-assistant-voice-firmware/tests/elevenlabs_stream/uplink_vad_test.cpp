@@ -0,0 +1,67 @@
+// uplink_vad_test.cpp
+#include "uplink_vad.h"
+#include "test_support.h"
+#include <cmath>
+#include <random>
+
+using namespace esphome::elevenlabs_stream;
+
+// A VAD listening to a room with steady background noise.
+struct Room {
+  UplinkVad vad;
+  std::mt19937 rng{1};
+  std::normal_distribution<float> noise;
+  uint32_t t{0};
+
+  explicit Room(float noise_stddev) : noise(0.0f, noise_stddev) {
+    this->vad.set_threshold(-50.0f);
+    this->vad.set_hangover(200);
+    this->vad.reset();
+  }
+
+  // Feeds `windows` windows of the room's noise plus, when `amplitude` is set, a tone
+  // standing in for speech. Returns how many of them left the gate open.
+  int feed(int windows, float amplitude) {
+    int16_t window[UplinkVad::WINDOW_SAMPLES];
+    int open = 0;
+    for (int w = 0; w < windows; w++) {
+      for (size_t i = 0; i < UplinkVad::WINDOW_SAMPLES; i++, this->t++) {
+        window[i] = static_cast<int16_t>(this->noise(this->rng) + amplitude * std::sin(this->t * 0.2f));
+      }
+      open += this->vad.process(window);
+    }
+    return open;
+  }
+};
+
+int main() {
+  // A quiet room (about -55 dBFS) never opens the gate.
+  Room room(60.0f);
+  CHECK(room.feed(50, 0) == 0);
+  CHECK(room.vad.noise_floor_db() < -50.0f);
+
+  // Speech opens it on the second window and holds it for the hangover (10 windows of
+  // 20ms) after the last one, then it closes.
+  CHECK(room.feed(1, 3000) == 0);
+  CHECK(room.feed(24, 3000) == 24);
+  CHECK(room.feed(10, 0) == 10);
+  CHECK(room.feed(1, 0) == 0);
+  CHECK(!room.vad.is_open());
+
+  // A single click does not.
+  CHECK(room.feed(1, 3000) == 0);
+  CHECK(room.feed(5, 0) == 0);
+
+  // A fan that starts and never stops opens the gate, but the floor follows it and the
+  // gate closes again within a minute.
+  std::normal_distribution<float> fan(0.0f, 1500.0f);
+  room.noise = fan;
+  CHECK(room.feed(5, 0) > 0);
+  room.feed(3000, 0);
+  CHECK(!room.vad.is_open());
+  CHECK(room.vad.noise_floor_db() > room.vad.level_db() - 10.0f);
+
+  // Speech over the fan still gets through.
+  CHECK(room.feed(10, 12000) >= 9);
+  return 0;
+}
@@ -0,0 +1,122 @@
+// websocket_assembler_test.cpp
+#include "websocket_assembler.h"
+#include "esphome/core/log.h"
+#include "test_support.h"
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace esphome::elevenlabs_stream;
+
+// A data event for message[offset, offset + length), the way esp_websocket_client
+// reports a piece of a single-frame message: the frame's FIN bit on every piece.
+static esp_websocket_event_data_t fragment(const std::string &message, size_t offset, size_t length) {
+  esp_websocket_event_data_t e{};
+  e.data_ptr = message.data() + offset;
+  e.data_len = static_cast<int>(length);
+  e.fin = true;
+  e.op_code = 0x01;
+  e.payload_len = static_cast<int>(message.size());
+  e.payload_offset = static_cast<int>(offset);
+  return e;
+}
+
+// Feeds the pieces in the order given; true if the last one completed the message.
+static bool feed(WebsocketMessageAssembler &assembler, const std::string &message,
+                 const std::vector<std::pair<size_t, size_t>> &pieces) {
+  bool ready = false;
+  for (auto &piece : pieces) {
+    esp_websocket_event_data_t e = fragment(message, piece.first, piece.second);
+    CHECK(!ready);
+    ready = assembler.add(&e);
+  }
+  return ready;
+}
+
+static bool holds(WebsocketMessageAssembler &assembler, const std::string &message) {
+  return assembler.isReady() && assembler.getSize() == message.size() &&
+         std::memcmp(assembler.getBuffer(), message.data(), message.size()) == 0;
+}
+
+static std::string text(size_t length, char first) {
+  std::string s(length, ' ');
+  for (size_t i = 0; i < length; i++) {
+    s[i] = static_cast<char>(first + i % 26);
+  }
+  return s;
+}
+
+int main() {
+  host_log_enabled = false;
+  WebsocketMessageAssembler assembler(1024);
+  std::string message = text(100, 'a');
+
+  // In order, in one piece and in several.
+  CHECK(feed(assembler, message, {{0, 100}}) && holds(assembler, message));
+  assembler.reset();
+  CHECK(!assembler.isReady() && assembler.getBuffer() == nullptr && assembler.getSize() == 0);
+  CHECK(feed(assembler, message, {{0, 30}, {30, 30}, {60, 40}}) && holds(assembler, message));
+  assembler.reset();
+
+  // Out of order: the message is complete only once the gap before the early pieces is
+  // filled, whichever order they came in. A retransmitted overlap changes nothing.
+  CHECK(feed(assembler, message, {{60, 40}, {20, 40}, {0, 10}, {5, 20}}) && holds(assembler, message));
+  assembler.reset();
+  CHECK(feed(assembler, message, {{0, 10}, {80, 20}, {40, 20}, {60, 20}, {10, 30}}) && holds(assembler, message));
+  assembler.reset();
+  ReceiveStats stats = assembler.getStats();
+  CHECK(stats.fragments == 13 && stats.messages == 4 && stats.out_of_order == 5 && stats.dropped == 0);
+
+  // One piece more ahead of the cursor than can be tracked: the message is dropped, and
+  // the rest of it skipped up to its final piece, so none of it passes for a new
+  // message. The one after it assembles normally.
+  std::vector<std::pair<size_t, size_t>> scattered;
+  for (size_t i = 0; i <= WebsocketMessageAssembler::kMaxPending; i++) {
+    scattered.push_back({10 + 10 * i, 5});
+  }
+  CHECK(!feed(assembler, message, scattered));
+  stats = assembler.getStats();
+  CHECK(stats.dropped == 1 && stats.out_of_order == 5 + WebsocketMessageAssembler::kMaxPending + 1);
+  CHECK(!feed(assembler, message, {{0, 10}, {15, 5}, {95, 5}}));
+  CHECK(!assembler.isReady());
+  std::string next = text(40, 'A');
+  CHECK(feed(assembler, next, {{0, 20}, {20, 20}}) && holds(assembler, next));
+  assembler.reset();
+
+  // Larger than the buffer: dropped at the first piece that does not fit, with nothing
+  // written past the end. A message that is over in that piece leaves nothing to skip.
+  std::string large = text(1500, 'a');
+  CHECK(!feed(assembler, large, {{0, 1500}}));
+  CHECK(feed(assembler, next, {{0, 40}}) && holds(assembler, next));
+  assembler.reset();
+  CHECK(!feed(assembler, large, {{0, 600}, {600, 600}, {1200, 300}}));
+  CHECK(feed(assembler, next, {{0, 40}}) && holds(assembler, next));
+  assembler.reset();
+  // Exactly the size of the buffer still fits.
+  std::string full = text(1024, 'a');
+  CHECK(feed(assembler, full, {{0, 512}, {512, 512}}) && holds(assembler, full));
+  assembler.reset();
+
+  // A malformed event is dropped too. Whether it was its message's last piece cannot
+  // be told, so everything up to the next final piece goes with it.
+  esp_websocket_event_data_t bad = fragment(message, 0, 100);
+  bad.payload_offset = -1;
+  CHECK(!assembler.add(&bad));
+  CHECK(!feed(assembler, next, {{0, 40}}));
+  CHECK(feed(assembler, next, {{0, 40}}) && holds(assembler, next));
+  assembler.reset();
+
+  // reset() in the middle of skipping, as a disconnect does: the next connection's
+  // first message is not mistaken for the rest of the dropped one.
+  CHECK(!feed(assembler, large, {{0, 600}, {600, 600}}));
+  assembler.reset();
+  CHECK(feed(assembler, next, {{0, 40}}) && holds(assembler, next));
+  assembler.reset();
+
+  stats = assembler.getStats();
+  CHECK(stats.dropped == 5 && stats.messages == 10);
+  CHECK(stats.fragments == 13 + 9 + 3 + 2 + 1 + 1 + 3 + 1 + 2 + 1 + 1 + 1 + 2 + 1);
+  // The slot counters belong to the client.
+  CHECK(stats.slot_waits == 0 && stats.slot_overruns == 0 && stats.streamed == 0);
+  return 0;
+}